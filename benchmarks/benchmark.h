@@ -0,0 +1,22 @@
+#ifndef LUNASVG_BENCHMARK_H
+#define LUNASVG_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+template<typename Function>
+double measure(int iterations, Function function)
+{
+    auto best = 1e300;
+    for(int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    return best;
+}
+
+#endif // LUNASVG_BENCHMARK_H
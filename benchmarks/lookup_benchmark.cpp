@@ -0,0 +1,45 @@
+#include "svgelement.h"
+#include "svgproperty.h"
+
+#include "benchmark.h"
+
+#include <string>
+#include <vector>
+
+using namespace lunasvg;
+
+template<typename Lookup>
+static size_t run(const char* name, const std::vector<std::string>& names, Lookup lookup)
+{
+    constexpr int kRounds = 100000;
+    size_t sink = 0;
+    auto elapsed = measure(5, [&] {
+        for(int i = 0; i < kRounds; ++i) {
+            for(const auto& name : names) {
+                sink += static_cast<size_t>(lookup(name));
+            }
+        }
+    });
+
+    std::printf("%-20s %10.2f ns/lookup\n", name, elapsed * 1e6 / (static_cast<double>(kRounds) * names.size()));
+    return sink;
+}
+
+int main()
+{
+    const std::vector<std::string> elementNames = {
+        "svg", "g", "path", "rect", "circle", "ellipse", "line", "polyline", "polygon", "text",
+        "tspan", "use", "symbol", "defs", "linearGradient", "radialGradient", "stop", "clipPath", "mask", "title"
+    };
+
+    const std::vector<std::string> propertyNames = {
+        "d", "fill", "stroke", "stroke-width", "transform", "x", "y", "width", "height", "id",
+        "class", "style", "viewBox", "opacity", "fill-opacity", "stroke-linecap", "stroke-linejoin", "cx", "cy", "data-name"
+    };
+
+    size_t sink = 0;
+    sink += run("elementid", elementNames, elementid);
+    sink += run("propertyid", propertyNames, propertyid);
+    sink += run("csspropertyid", propertyNames, csspropertyid);
+    return sink == 0;
+}
@@ -0,0 +1,122 @@
+#include "svgparserutils.h"
+
+#include "benchmark.h"
+
+#include <string>
+#include <vector>
+
+using namespace lunasvg;
+
+// The digit-by-digit parser that parseNumber replaced, kept for comparison.
+template<typename T>
+static bool parseNumberLegacy(std::string_view& input, T& number)
+{
+    constexpr T maxValue = std::numeric_limits<T>::max();
+    T integer = 0;
+    T fraction = 0;
+    int exponent = 0;
+    int sign = 1;
+    int expsign = 1;
+
+    if(!input.empty() && input.front() == '+') {
+        input.remove_prefix(1);
+    } else if(!input.empty() && input.front() == '-') {
+        input.remove_prefix(1);
+        sign = -1;
+    }
+
+    if(input.empty() || (!IS_NUM(input.front()) && input.front() != '.'))
+        return false;
+    if(IS_NUM(input.front())) {
+        do {
+            integer = static_cast<T>(10) * integer + (input.front() - '0');
+            input.remove_prefix(1);
+        } while(!input.empty() && IS_NUM(input.front()));
+    }
+
+    if(!input.empty() && input.front() == '.') {
+        input.remove_prefix(1);
+        if(input.empty() || !IS_NUM(input.front()))
+            return false;
+        T divisor = static_cast<T>(1);
+        do {
+            fraction = static_cast<T>(10) * fraction + (input.front() - '0');
+            divisor *= static_cast<T>(10);
+            input.remove_prefix(1);
+        } while(!input.empty() && IS_NUM(input.front()));
+        fraction /= divisor;
+    }
+
+    if(input.size() > 1 && (input[0] == 'e' || input[0] == 'E')
+        && (input[1] != 'x' && input[1] != 'm'))
+    {
+        input.remove_prefix(1);
+        if(!input.empty() && input.front() == '+')
+            input.remove_prefix(1);
+        else if(!input.empty() && input.front() == '-') {
+            input.remove_prefix(1);
+            expsign = -1;
+        }
+
+        if(input.empty() || !IS_NUM(input.front()))
+            return false;
+        do {
+            exponent = 10 * exponent + (input.front() - '0');
+            input.remove_prefix(1);
+        } while(!input.empty() && IS_NUM(input.front()));
+    }
+
+    number = sign * (integer + fraction);
+    if(exponent)
+        number *= static_cast<T>(std::pow(10.0, expsign * exponent));
+    return number >= -maxValue && number <= maxValue;
+}
+
+static std::string makeCoordinates(int count, int decimals)
+{
+    std::string data;
+    for(int i = 0; i < count; ++i) {
+        auto value = std::to_string(int(i * 7919u % 20000u) - 10000);
+        if(decimals > 0)
+            value += '.' + std::to_string(i * 104729u % 1000000u + 1000000u).substr(1, decimals);
+        data += value;
+        data += i % 2 ? ' ' : ',';
+    }
+
+    return data;
+}
+
+template<typename Parse>
+static float run(const char* name, const std::string& data, Parse parse)
+{
+    float sink = 0;
+    size_t count = 0;
+    auto elapsed = measure(20, [&] {
+        count = 0;
+        std::string_view input(data);
+        float number;
+        while(parse(input, number)) {
+            sink += number;
+            ++count;
+            if(input.empty())
+                break;
+            input.remove_prefix(1);
+        }
+    });
+
+    std::printf("%-24s %10.2f ns/number\n", name, elapsed * 1e6 / count);
+    return sink;
+}
+
+int main()
+{
+    float sink = 0;
+    for(int decimals : {0, 2, 6}) {
+        const auto data = makeCoordinates(1000000, decimals);
+        std::printf("%d decimals\n", decimals);
+        sink += run("  parseNumber", data, parseNumber<float>);
+        sink += run("  legacy", data, parseNumberLegacy<float>);
+    }
+
+    return sink == 0;
+}
@@ -0,0 +1,102 @@
+#include <lunasvg.h>
+
+#include "benchmark.h"
+
+#include <string>
+
+using namespace lunasvg;
+
+static std::string makeSprite(int count)
+{
+    std::string data = "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\">\n";
+    for(int i = 0; i < count; ++i) {
+        data += "  <symbol id=\"icon-" + std::to_string(i) + "\" viewBox=\"0 0 24 24\" class=\"icon icon-outline\">\n";
+        data += "    <title>Icon number " + std::to_string(i) + " &amp; friends</title>\n";
+        data += "    <path fill=\"none\" stroke=\"currentColor\" stroke-width=\"2\" stroke-linecap=\"round\" stroke-linejoin=\"round\" d=\"M12 2L2 7l10 5 10-5-10-5zM2 17l10 5 10-5M2 12l10 5 10-5\"/>\n";
+        data += "  </symbol>\n";
+    }
+
+    data += "</svg>\n";
+    return data;
+}
+
+static std::string makeUnknownMarkup(int count)
+{
+    std::string data = "<svg xmlns=\"http://www.w3.org/2000/svg\">\n";
+    for(int i = 0; i < count; ++i) {
+        data += "  <x:symbol id=\"icon-" + std::to_string(i) + "\" viewBox=\"0 0 24 24\" class=\"icon icon-outline\">\n";
+        data += "    <x:title>Icon number " + std::to_string(i) + " &amp; friends</x:title>\n";
+        data += "    <x:path fill=\"none\" stroke=\"currentColor\" stroke-width=\"2\" stroke-linecap=\"round\" stroke-linejoin=\"round\" d=\"M12 2L2 7l10 5 10-5-10-5zM2 17l10 5 10-5M2 12l10 5 10-5\"/>\n";
+        data += "  </x:symbol>\n";
+    }
+
+    data += "</svg>\n";
+    return data;
+}
+
+static std::string makeText(int count)
+{
+    std::string data = "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"800\" height=\"600\">\n";
+    for(int i = 0; i < count; ++i) {
+        data += "  <text x=\"10\" y=\"" + std::to_string(i % 600) + "\">";
+        data += "The quick brown fox jumps over the lazy dog while the SVG tokenizer scans this rather long run of character data &lt;" + std::to_string(i) + "&gt;";
+        data += "</text>\n";
+    }
+
+    data += "</svg>\n";
+    return data;
+}
+
+static std::string makeLongAttributes(int count)
+{
+    std::string data = "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"1000\" height=\"1000\">\n";
+    for(int i = 0; i < count; ++i) {
+        data += "  <polyline fill=\"none\" stroke=\"black\" points=\"";
+        for(int j = 0; j < 64; ++j)
+            data += std::to_string((i * 7 + j * 13) % 1000) + "," + std::to_string((i * 11 + j * 3) % 1000) + " ";
+        data += "\"/>\n";
+    }
+
+    data += "</svg>\n";
+    return data;
+}
+
+static std::string makeSymbolLibrary(int symbols, int count)
+{
+    std::string data = "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"1000\" height=\"1000\">\n";
+    for(int i = 0; i < symbols; ++i) {
+        data += "  <symbol id=\"s" + std::to_string(i) + "\" viewBox=\"0 0 24 24\">\n";
+        data += "    <path stroke=\"currentColor\" stroke-width=\"2\" d=\"M12 2L2 7l10 5 10-5-10-5zM2 17l10 5 10-5M2 12l10 5 10-5\"/>\n";
+        data += "    <circle cx=\"12\" cy=\"12\" r=\"" + std::to_string(i % 10 + 1) + "\" fill=\"none\"/>\n";
+        data += "  </symbol>\n";
+    }
+
+    for(int i = 0; i < count; ++i) {
+        data += "  <use xlink:href=\"#s" + std::to_string(i % symbols) + "\" x=\"" + std::to_string(i % 1000) + "\" y=\"" + std::to_string(i / 1000 * 24) + "\" width=\"24\" height=\"24\"/>\n";
+    }
+
+    data += "</svg>\n";
+    return data;
+}
+
+static void run(const char* name, const std::string& data)
+{
+    auto elapsed = measure(20, [&] {
+        auto document = Document::loadFromData(data);
+        if(document == nullptr) {
+            std::fprintf(stderr, "%s: failed to parse\n", name);
+        }
+    });
+
+    std::printf("%-20s %10.3f ms %10.1f MB/s\n", name, elapsed, data.size() / elapsed / 1000.0);
+}
+
+int main()
+{
+    run("unknown markup", makeUnknownMarkup(20000));
+    run("sprite", makeSprite(20000));
+    run("text", makeText(20000));
+    run("long attributes", makeLongAttributes(10000));
+    run("symbol library", makeSymbolLibrary(30, 20000));
+    return 0;
+}
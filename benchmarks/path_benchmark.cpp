@@ -0,0 +1,55 @@
+#include <plutovg.h>
+
+#include "benchmark.h"
+
+#include <string>
+
+static std::string makeLines(int count)
+{
+    std::string data = "M0 0";
+    for(int i = 0; i < count; ++i)
+        data += " " + std::to_string((i * 7) % 1000) + "," + std::to_string((i * 13) % 1000);
+    return data;
+}
+
+static std::string makeCurves(int count)
+{
+    std::string data = "M0 0";
+    for(int i = 0; i < count; ++i) {
+        data += "c" + std::to_string(i % 17) + " 3 5-" + std::to_string(i % 11) + " 9 0";
+        data += "h" + std::to_string(i % 23) + "v-4s2 2 4 0";
+    }
+
+    return data + "z";
+}
+
+static std::string makeIcon()
+{
+    return "M12 2L2 7l10 5 10-5-10-5zM2 17l10 5 10-5M2 12l10 5 10-5";
+}
+
+static void run(const char* name, const std::string& data, int repeat)
+{
+    int elements = 0;
+    auto elapsed = measure(10, [&] {
+        for(int i = 0; i < repeat; ++i) {
+            plutovg_path_t* path = plutovg_path_create();
+            plutovg_path_parse(path, data.data(), data.size());
+            elements += plutovg_path_get_elements(path, nullptr);
+            plutovg_path_destroy(path);
+        }
+    });
+
+    std::printf("%-20s %10.3f ms %10.1f MB/s\n", name, elapsed, data.size() * repeat / (elapsed * 1000.0));
+    if(elements == 0) {
+        std::printf("%-20s failed to parse\n", name);
+    }
+}
+
+int main()
+{
+    run("lines", makeLines(1000000), 1);
+    run("curves", makeCurves(100000), 1);
+    run("icons", makeIcon(), 100000);
+    return 0;
+}
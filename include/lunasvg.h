@@ -24,6 +24,7 @@
 #define LUNASVG_H
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -589,11 +590,19 @@ public:
      * @brief Retrieves the value of an attribute.
      * @param name The name of the attribute to retrieve.
      * @return The value of the attribute as a string.
+     * @note If the document releases attribute text (see `Document::setKeepAttributeText`), released values
+     * are regenerated from their parsed form and may differ from the original source. The regenerated text is
+     * kept by the element until the attribute is set again.
      */
     const std::string& getAttribute(const std::string& name) const;
 
     /**
      * @brief Sets the value of an attribute.
+     *
+     * Changing the `id` attribute updates `Document::getElementById` and every reference to the old or new id.
+     * A `<use>` element whose target contains the element rebuilds its instance, so nodes previously
+     * read from that instance are destroyed.
+     *
      * @param name The name of the attribute to set.
      * @param value The value to assign to the attribute.
      */
@@ -660,17 +669,103 @@ private:
 
 using ElementList = std::vector<Element>;
 
+class RuleSet;
+
+class LUNASVG_API StyleSheet {
+public:
+    /**
+     * @brief Constructs an empty stylesheet.
+     */
+    StyleSheet() = default;
+
+    /**
+     * @brief Parses a CSS stylesheet.
+     * @param content A string containing the CSS rules, with comments removed.
+     *
+     * The parsed rules are immutable and shared between copies, so a single
+     * stylesheet can be applied to any number of documents, from any thread.
+     */
+    explicit StyleSheet(const std::string& content);
+
+    /**
+     * @brief Checks if the stylesheet contains no rules.
+     * @return True if the stylesheet is empty, false otherwise.
+     */
+    bool isEmpty() const;
+
+private:
+    std::shared_ptr<const RuleSet> m_ruleSet;
+    friend class Document;
+};
+
+/**
+ * @brief Limits applied while loading a document.
+ *
+ * Loading stops as soon as a limit is exceeded. A value of zero means no limit.
+ * The image limit also applies whenever an image is decoded after loading, for example
+ * after its `href` changes; images that would exceed it are not drawn.
+ */
+struct ParseOptions {
+    size_t maxDataSize = 0; ///< Maximum size of the SVG data in bytes, after decompression.
+    size_t maxElements = 0; ///< Maximum number of elements in the source, including unsupported ones.
+    size_t maxDepth = 0; ///< Maximum nesting depth of elements in the source.
+    size_t maxUseExpansion = 0; ///< Maximum total number of elements instantiated by `<use>` references.
+    size_t maxImagePixels = 0; ///< Maximum total number of pixels of distinct images referenced by `<image>` elements.
+    bool deferAttributeParsing = false; ///< Parse attribute values when an element is first laid out or referenced, instead of when they are set.
+};
+
+/**
+ * @brief Describes why a document failed to load.
+ */
+enum class ParseError {
+    None, ///< The document loaded successfully.
+    ReadFailed, ///< The file could not be opened or read.
+    InvalidDocument, ///< The data is not a well-formed SVG document.
+    DataTooLarge, ///< The data exceeds `ParseOptions::maxDataSize`.
+    TooManyElements, ///< The source exceeds `ParseOptions::maxElements`.
+    TooDeep, ///< The source exceeds `ParseOptions::maxDepth`.
+    UseExpansionTooLarge, ///< `<use>` references exceed `ParseOptions::maxUseExpansion`.
+    ImagesTooLarge ///< Referenced images exceed `ParseOptions::maxImagePixels`.
+};
+
+/**
+ * @brief Runs `count` independent tasks, each receiving its index, and returns once all of them have completed.
+ *
+ * Tasks may run concurrently, in any order and on any thread, including the calling one.
+ */
+using ParallelExecutor = std::function<void(size_t count, const std::function<void(size_t index)>& task)>;
+
 class SVGRootElement;
+class Arena;
 
 class LUNASVG_API Document {
 public:
     /**
      * @brief Load an SVG document from a file.
+     *
+     * Gzip-compressed files (`.svgz`) are decompressed transparently.
+     *
+     * @note The file is memory-mapped while it is parsed; see `loadFromFile(int)`.
+     *
      * @param filename The path to the SVG file.
      * @return A pointer to the loaded `Document`, or `nullptr` on failure.
      */
     static std::unique_ptr<Document> loadFromFile(const std::string& filename);
 
+    /**
+     * @brief Load an SVG document from an open file descriptor.
+     *
+     * A seekable descriptor is always read from the start of the file, whatever its current offset;
+     * pipes and sockets are read from their current position until end of file.
+     *
+     * @note Regular files are memory-mapped while they are parsed. As with any mapping, the process
+     * receives `SIGBUS` if the file is truncated by someone else before loading returns.
+     *
+     * @param fd A file descriptor opened for reading. It is not closed by this function.
+     * @return A pointer to the loaded `Document`, or `nullptr` on failure.
+     */
+    static std::unique_ptr<Document> loadFromFile(int fd);
+
     /**
      * @brief Load an SVG document from a string.
      * @param string The SVG data as a string.
@@ -687,18 +782,99 @@ public:
 
     /**
      * @brief Load an SVG document from a string with a specified length.
+     *
+     * Gzip-compressed data is decompressed transparently.
+     *
      * @param data The string containing the SVG data.
      * @param length The length of the string in bytes.
      * @return A pointer to the loaded `Document`, or `nullptr` on failure.
      */
     static std::unique_ptr<Document> loadFromData(const char* data, size_t length);
 
+    /**
+     * @brief Load an SVG document from a file, enforcing resource limits.
+     * @param filename The path to the SVG file.
+     * @param options The limits to enforce while loading.
+     * @param error If not `nullptr`, receives the reason for a failure, or `ParseError::None` on success.
+     * @return A pointer to the loaded `Document`, or `nullptr` on failure.
+     */
+    static std::unique_ptr<Document> loadFromFile(const std::string& filename, const ParseOptions& options, ParseError* error = nullptr);
+
+    /**
+     * @brief Load an SVG document from an open file descriptor, enforcing resource limits.
+     *
+     * The descriptor is read as described for `loadFromFile(int)`.
+     *
+     * @param fd A file descriptor opened for reading. It is not closed by this function.
+     * @param options The limits to enforce while loading.
+     * @param error If not `nullptr`, receives the reason for a failure, or `ParseError::None` on success.
+     * @return A pointer to the loaded `Document`, or `nullptr` on failure.
+     */
+    static std::unique_ptr<Document> loadFromFile(int fd, const ParseOptions& options, ParseError* error = nullptr);
+
+    /**
+     * @brief Load an SVG document from a string with a specified length, enforcing resource limits.
+     * @param data The string containing the SVG data.
+     * @param length The length of the string in bytes.
+     * @param options The limits to enforce while loading.
+     * @param error If not `nullptr`, receives the reason for a failure, or `ParseError::None` on success.
+     * @return A pointer to the loaded `Document`, or `nullptr` on failure.
+     */
+    static std::unique_ptr<Document> loadFromData(const char* data, size_t length, const ParseOptions& options, ParseError* error = nullptr);
+
+    /**
+     * @brief Load an SVG document from a snapshot created by `serialize`.
+     * @note Loading skips tokenizing, stylesheet matching and `<use>` resolution, but still creates every node
+     * and copies the attribute text, so the snapshot cannot be rendered in place.
+     * @param data Pointer to the snapshot data. It is not retained after the call returns.
+     * @param length The size of the snapshot in bytes.
+     * @return A pointer to the loaded `Document`, or `nullptr` if the snapshot is invalid or from an incompatible version.
+     */
+    static std::unique_ptr<Document> loadFromSnapshot(const void* data, size_t length);
+
+    /**
+     * @brief Reads the intrinsic size and view box of an SVG document without building it.
+     *
+     * Only the data up to the root `<svg>` start tag is parsed. The document is fully loaded
+     * only if the size depends on its content, or on a font size given in `em` or `ex` units.
+     * @param data The string containing the SVG data.
+     * @param length The length of the string in bytes.
+     * @param width Receives the intrinsic width, as returned by `width()`.
+     * @param height Receives the intrinsic height, as returned by `height()`.
+     * @param viewBox Receives the view box of the root element, or an empty box if it has none.
+     * @return `true` on success, `false` if the root element could not be read or the required full load failed.
+     * @note Content after the root start tag is not validated unless the document is fully loaded.
+     */
+    static bool probe(const char* data, size_t length, float& width, float& height, Box& viewBox);
+
+    /**
+     * @brief Serializes the built document into a compact binary snapshot.
+     * @note The snapshot stores the document after stylesheets and `<use>` references have been resolved,
+     * using the byte order of the current machine.
+     * @return The snapshot data.
+     */
+    std::vector<uint8_t> serialize() const;
+
+    /**
+     * @brief Creates an independent copy of the document.
+     * @note Parsed paths, decoded images and attribute strings are shared with this document
+     * and only copied when either document modifies them.
+     * @return A pointer to the new `Document`.
+     */
+    std::unique_ptr<Document> clone() const;
+
     /**
      * @brief Applies a CSS stylesheet to the document.
      * @param content A string containing the CSS rules to apply, with comments removed.
      */
     void applyStyleSheet(const std::string& content);
 
+    /**
+     * @brief Applies a pre-parsed CSS stylesheet to the document.
+     * @param styleSheet The stylesheet to apply.
+     */
+    void applyStyleSheet(const StyleSheet& styleSheet);
+
     /**
      * @brief Selects all elements that match the given CSS selector(s).
      * @param content A string containing the CSS selector(s) to match elements.
@@ -726,14 +902,41 @@ public:
 
     /**
      * @brief Updates the layout of the document if needed.
+     *
+     * Only the subtrees whose attributes or text changed since the last layout are laid out again.
      */
     void updateLayout();
 
     /**
      * @brief Forces an immediate layout update.
+     *
+     * The whole document is laid out again, regardless of what has changed.
      */
     void forceLayout();
 
+    /**
+     * @brief Sets whether large attribute values are kept as text after they have been parsed.
+     *
+     * Text is kept by default. When it is not kept, `updateLayout` and `forceLayout` release path data and
+     * embedded image data URIs of 1 KB or more that are already held in parsed or decoded form. Images are
+     * decoded on first render, so their text is released by the next layout call after that.
+     * `Element::getAttribute` regenerates released values: path data as absolute `M`, `L`, `C` and `Z`
+     * commands, and images as PNG data URIs.
+     * Nothing is released while the document shares its text with a clone.
+     * @param keep True to keep the original text, false to release it.
+     */
+    void setKeepAttributeText(bool keep);
+
+    /**
+     * @brief Sets the executor used to lay out large groups of sibling elements in parallel.
+     *
+     * Layout runs on the calling thread by default. With an executor, the children of any element with
+     * at least 1024 children are split into batches that are laid out as executor tasks. Batches are not
+     * split again, so the executor is never re-entered from one of its own tasks.
+     * @param executor The executor to use, or an empty function to lay out serially.
+     */
+    void setLayoutExecutor(ParallelExecutor executor);
+
     /**
      * @brief Renders the document onto a bitmap using a transformation matrix.
      * @param bitmap The bitmap to render onto.
@@ -780,10 +983,61 @@ private:
     Document(const Document&) = delete;
     Document& operator=(const Document&) = delete;
     SVGRootElement* rootElement(bool layoutIfNeeded = false) const;
-    bool parse(const char* data, size_t length);
+    ParseError parse(const char* data, size_t length, const ParseOptions& options);
+    std::unique_ptr<Arena> m_arena;
     std::unique_ptr<SVGRootElement> m_rootElement;
     friend class SVGURIReference;
     friend class SVGNode;
+    friend class SVGParser;
+    friend class DocumentBuilder;
+};
+
+class SVGParser;
+
+class LUNASVG_API DocumentBuilder {
+public:
+    /**
+     * @brief Constructs a builder for an SVG document delivered in chunks.
+     */
+    DocumentBuilder();
+
+    /**
+     * @brief Constructs a builder that enforces resource limits.
+     * @param options The limits to enforce while loading.
+     */
+    explicit DocumentBuilder(const ParseOptions& options);
+
+    /**
+     * @brief Parses the next chunk of SVG data.
+     *
+     * If the first chunk starts a gzip stream, the data is inflated as it arrives.
+     *
+     * @param data The chunk of SVG data.
+     * @param length The length of the chunk in bytes.
+     * @return `true` if the data received so far is well-formed, `false` otherwise.
+     */
+    bool feed(const char* data, size_t length);
+
+    /**
+     * @brief Completes parsing after the last chunk has been fed.
+     * @return A pointer to the loaded `Document`, or `nullptr` on failure.
+     */
+    std::unique_ptr<Document> finish();
+
+    /**
+     * @brief Returns the reason the last call to `feed` or `finish` failed.
+     * @return The parse error, or `ParseError::None` if no error occurred.
+     */
+    ParseError error() const { return m_error; }
+
+    ~DocumentBuilder();
+
+private:
+    DocumentBuilder(const DocumentBuilder&) = delete;
+    DocumentBuilder& operator=(const DocumentBuilder&) = delete;
+    std::unique_ptr<Document> m_document;
+    std::unique_ptr<SVGParser> m_parser;
+    ParseError m_error = ParseError::None;
 };
 
 } // namespace lunasvg
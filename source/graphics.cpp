@@ -488,6 +488,19 @@ float Font::measureText(const std::u32string_view& text) const
     return 0;
 }
 
+void DashArray::push_back(float value)
+{
+    if(m_size < kInlineCapacity) {
+        m_inline[m_size++] = value;
+        return;
+    }
+
+    if(m_size == kInlineCapacity)
+        m_overflow.assign(m_inline.begin(), m_inline.end());
+    m_overflow.push_back(value);
+    ++m_size;
+}
+
 std::shared_ptr<Canvas> Canvas::create(const Bitmap& bitmap)
 {
     return std::shared_ptr<Canvas>(new Canvas(bitmap));
@@ -468,7 +468,26 @@ enum class BlendMode {
     Dst_Out = PLUTOVG_OPERATOR_DST_OUT
 };
 
-using DashArray = std::vector<float>;
+class DashArray {
+public:
+    static constexpr size_t kInlineCapacity = 8;
+
+    DashArray() = default;
+
+    bool empty() const { return m_size == 0; }
+    size_t size() const { return m_size; }
+
+    const float* data() const { return m_size > kInlineCapacity ? m_overflow.data() : m_inline.data(); }
+    const float* begin() const { return data(); }
+    const float* end() const { return data() + m_size; }
+
+    void push_back(float value);
+
+private:
+    size_t m_size = 0;
+    std::array<float, kInlineCapacity> m_inline;
+    std::vector<float> m_overflow;
+};
 
 class StrokeData {
 public:
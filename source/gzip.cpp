@@ -0,0 +1,488 @@
+#include "gzip.h"
+
+#include <algorithm>
+
+namespace lunasvg {
+
+constexpr size_t kWindowSize = 32768;
+constexpr size_t kOutputChunkSize = 65536;
+
+constexpr uint16_t kLengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+constexpr uint8_t kLengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+constexpr uint16_t kDistanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+constexpr uint8_t kDistanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+constexpr uint8_t kCodeLengthOrder[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+struct Crc32Table {
+    constexpr Crc32Table()
+        : values()
+    {
+        for(uint32_t index = 0; index < 256; ++index) {
+            uint32_t value = index;
+            for(int bit = 0; bit < 8; ++bit)
+                value = value & 1 ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+            values[index] = value;
+        }
+    }
+
+    uint32_t values[256];
+};
+
+constexpr Crc32Table crc32Table;
+
+GzipDecoder::GzipDecoder()
+    : m_window(kWindowSize)
+{
+}
+
+bool GzipDecoder::decode(const char* data, size_t length, const WriteFunc& write)
+{
+    if(m_state == State::Failed)
+        return false;
+    if(m_pending.empty()) {
+        m_data = reinterpret_cast<const uint8_t*>(data);
+        m_size = length;
+    } else {
+        m_pending.insert(m_pending.end(), data, data + length);
+        m_data = m_pending.data();
+        m_size = m_pending.size();
+    }
+
+    m_write = &write;
+    auto result = run();
+    if(result != Result::Error && !flush())
+        result = Result::Error;
+    m_write = nullptr;
+    if(result == Result::Error) {
+        m_state = State::Failed;
+        m_pending.clear();
+        return false;
+    }
+
+    const auto consumed = m_bitPosition >> 3;
+    if(m_data == m_pending.data()) {
+        m_pending.erase(m_pending.begin(), m_pending.begin() + consumed);
+    } else {
+        m_pending.assign(m_data + consumed, m_data + m_size);
+    }
+
+    m_bitPosition &= 7;
+    m_data = nullptr;
+    m_size = 0;
+    return true;
+}
+
+GzipDecoder::Result GzipDecoder::run()
+{
+    while(true) {
+        Result result;
+        switch(m_state) {
+        case State::Header:
+            result = readHeader();
+            break;
+        case State::BlockHeader:
+            result = readBlockHeader();
+            break;
+        case State::Stored:
+            result = copyStored();
+            break;
+        case State::Huffman:
+            result = decodeHuffman();
+            break;
+        case State::Trailer:
+            result = readTrailer();
+            break;
+        case State::Finished:
+            return m_bitPosition == 8 * m_size ? Result::Ok : Result::Error;
+        default:
+            return Result::Error;
+        }
+
+        if(result != Result::Ok) {
+            return result;
+        }
+    }
+}
+
+int GzipDecoder::buildHuffman(Huffman& huffman, const uint8_t* lengths, int count)
+{
+    auto counts = huffman.counts;
+    std::fill(counts, counts + 16, 0);
+    std::fill(huffman.fast, huffman.fast + 512, 0);
+    for(int symbol = 0; symbol < count; ++symbol)
+        ++counts[lengths[symbol]];
+    if(counts[0] == count)
+        return 0;
+    int left = 1;
+    for(int length = 1; length < 16; ++length) {
+        left = (left << 1) - counts[length];
+        if(left < 0) {
+            return left;
+        }
+    }
+
+    uint16_t offsets[16] = {0};
+    uint32_t codes[16] = {0};
+    for(int length = 1; length < 15; ++length) {
+        offsets[length + 1] = offsets[length] + counts[length];
+        codes[length + 1] = (codes[length] + counts[length]) << 1;
+    }
+
+    for(int symbol = 0; symbol < count; ++symbol) {
+        const int length = lengths[symbol];
+        if(length == 0)
+            continue;
+        huffman.symbols[offsets[length]++] = symbol;
+        const auto code = codes[length]++;
+        if(length > 9)
+            continue;
+        uint32_t reversed = 0;
+        for(int bit = 0; bit < length; ++bit)
+            reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+        for(auto index = reversed; index < 512; index += 1u << length) {
+            huffman.fast[index] = symbol | length << 9;
+        }
+    }
+
+    return left;
+}
+
+GzipDecoder::Result GzipDecoder::readHeader()
+{
+    auto position = m_bitPosition >> 3;
+    if(m_size - position < 10)
+        return Result::NeedInput;
+    const auto header = m_data + position;
+    const auto flags = header[3];
+    if(header[0] != 0x1F || header[1] != 0x8B || header[2] != 8 || (flags & 0xE0))
+        return Result::Error;
+    position += 10;
+    if(flags & 0x04) {
+        if(m_size - position < 2)
+            return Result::NeedInput;
+        position += 2 + (m_data[position] | m_data[position + 1] << 8);
+        if(position > m_size) {
+            return Result::NeedInput;
+        }
+    }
+
+    for(int flag : {0x08, 0x10}) {
+        if(flags & flag) {
+            auto end = std::find(m_data + position, m_data + m_size, 0);
+            if(end == m_data + m_size)
+                return Result::NeedInput;
+            position = end - m_data + 1;
+        }
+    }
+
+    if(flags & 0x02) {
+        if(m_size - position < 2)
+            return Result::NeedInput;
+        position += 2;
+    }
+
+    m_bitPosition = 8 * position;
+    m_state = State::BlockHeader;
+    return Result::Ok;
+}
+
+GzipDecoder::Result GzipDecoder::readBlockHeader()
+{
+    const auto start = m_bitPosition;
+    uint32_t finalBlock, type;
+    if(!readBits(1, finalBlock) || !readBits(2, type)) {
+        m_bitPosition = start;
+        return Result::NeedInput;
+    }
+
+    m_finalBlock = finalBlock;
+    if(type == 0) {
+        const auto position = (m_bitPosition + 7) >> 3;
+        if(m_size < position + 4) {
+            m_bitPosition = start;
+            return Result::NeedInput;
+        }
+
+        const auto header = m_data + position;
+        const uint32_t length = header[0] | header[1] << 8;
+        const uint32_t complement = header[2] | header[3] << 8;
+        if(length != (~complement & 0xFFFF))
+            return Result::Error;
+        m_bitPosition = 8 * (position + 4);
+        m_storedRemaining = length;
+        m_state = State::Stored;
+        return Result::Ok;
+    }
+
+    if(type == 1) {
+        uint8_t lengths[288 + 30];
+        std::fill(lengths, lengths + 144, 8);
+        std::fill(lengths + 144, lengths + 256, 9);
+        std::fill(lengths + 256, lengths + 280, 7);
+        std::fill(lengths + 280, lengths + 288, 8);
+        std::fill(lengths + 288, lengths + 318, 5);
+        buildHuffman(m_lengthCode, lengths, 288);
+        buildHuffman(m_distanceCode, lengths + 288, 30);
+        m_state = State::Huffman;
+        return Result::Ok;
+    }
+
+    if(type == 2) {
+        auto result = readDynamicTables();
+        if(result == Result::NeedInput)
+            m_bitPosition = start;
+        if(result == Result::Ok)
+            m_state = State::Huffman;
+        return result;
+    }
+
+    return Result::Error;
+}
+
+GzipDecoder::Result GzipDecoder::readDynamicTables()
+{
+    uint32_t lengthCount, distanceCount, codeCount;
+    if(!readBits(5, lengthCount) || !readBits(5, distanceCount) || !readBits(4, codeCount))
+        return Result::NeedInput;
+    lengthCount += 257;
+    distanceCount += 1;
+    codeCount += 4;
+    if(lengthCount > 286 || distanceCount > 30)
+        return Result::Error;
+    uint8_t lengths[286 + 30] = {0};
+    for(uint32_t index = 0; index < codeCount; ++index) {
+        uint32_t length;
+        if(!readBits(3, length))
+            return Result::NeedInput;
+        lengths[kCodeLengthOrder[index]] = length;
+    }
+
+    Huffman codeLengthCode;
+    if(buildHuffman(codeLengthCode, lengths, 19) != 0)
+        return Result::Error;
+    std::fill(lengths, lengths + 19, 0);
+
+    uint32_t index = 0;
+    while(index < lengthCount + distanceCount) {
+        int symbol;
+        auto result = decodeSymbol(codeLengthCode, symbol);
+        if(result != Result::Ok)
+            return result;
+        if(symbol < 16) {
+            lengths[index++] = symbol;
+            continue;
+        }
+
+        uint8_t length = 0;
+        uint32_t repeat;
+        if(symbol == 16) {
+            if(index == 0)
+                return Result::Error;
+            length = lengths[index - 1];
+            if(!readBits(2, repeat))
+                return Result::NeedInput;
+            repeat += 3;
+        } else if(symbol == 17) {
+            if(!readBits(3, repeat))
+                return Result::NeedInput;
+            repeat += 3;
+        } else {
+            if(!readBits(7, repeat))
+                return Result::NeedInput;
+            repeat += 11;
+        }
+
+        if(index + repeat > lengthCount + distanceCount)
+            return Result::Error;
+        while(repeat--) {
+            lengths[index++] = length;
+        }
+    }
+
+    if(lengths[256] == 0)
+        return Result::Error;
+    auto left = buildHuffman(m_lengthCode, lengths, lengthCount);
+    if(left < 0 || (left > 0 && lengthCount != m_lengthCode.counts[0] + m_lengthCode.counts[1]))
+        return Result::Error;
+    left = buildHuffman(m_distanceCode, lengths + lengthCount, distanceCount);
+    if(left < 0 || (left > 0 && distanceCount != m_distanceCode.counts[0] + m_distanceCode.counts[1]))
+        return Result::Error;
+    return Result::Ok;
+}
+
+GzipDecoder::Result GzipDecoder::copyStored()
+{
+    auto position = m_bitPosition >> 3;
+    while(m_storedRemaining > 0) {
+        if(position == m_size) {
+            m_bitPosition = 8 * position;
+            return Result::NeedInput;
+        }
+
+        writeByte(m_data[position++]);
+        --m_storedRemaining;
+        if(m_output.size() >= kOutputChunkSize && !flush()) {
+            return Result::Error;
+        }
+    }
+
+    m_bitPosition = 8 * position;
+    m_state = m_finalBlock ? State::Trailer : State::BlockHeader;
+    return Result::Ok;
+}
+
+GzipDecoder::Result GzipDecoder::decodeHuffman()
+{
+    while(true) {
+        const auto start = m_bitPosition;
+        int symbol;
+        auto result = decodeSymbol(m_lengthCode, symbol);
+        if(result == Result::Ok && symbol >= 257) {
+            symbol -= 257;
+            uint32_t extra;
+            int distanceSymbol;
+            if(symbol >= 29)
+                return Result::Error;
+            if(!readBits(kLengthExtra[symbol], extra)) {
+                result = Result::NeedInput;
+            } else {
+                const auto length = kLengthBase[symbol] + extra;
+                result = decodeSymbol(m_distanceCode, distanceSymbol);
+                if(result == Result::Ok && distanceSymbol >= 30)
+                    return Result::Error;
+                if(result == Result::Ok && !readBits(kDistanceExtra[distanceSymbol], extra))
+                    result = Result::NeedInput;
+                if(result == Result::Ok) {
+                    const size_t distance = kDistanceBase[distanceSymbol] + extra;
+                    if(distance > m_totalOutput)
+                        return Result::Error;
+                    for(uint32_t index = 0; index < length; ++index) {
+                        writeByte(m_window[(m_windowPosition - distance) & (kWindowSize - 1)]);
+                    }
+                }
+            }
+        } else if(result == Result::Ok && symbol < 256) {
+            writeByte(symbol);
+        } else if(result == Result::Ok) {
+            m_state = m_finalBlock ? State::Trailer : State::BlockHeader;
+            return Result::Ok;
+        }
+
+        if(result == Result::NeedInput)
+            m_bitPosition = start;
+        if(result != Result::Ok)
+            return result;
+        if(m_output.size() >= kOutputChunkSize && !flush()) {
+            return Result::Error;
+        }
+    }
+}
+
+GzipDecoder::Result GzipDecoder::readTrailer()
+{
+    const auto position = (m_bitPosition + 7) >> 3;
+    if(m_size < position + 8)
+        return Result::NeedInput;
+    if(!flush())
+        return Result::Error;
+    const auto trailer = m_data + position;
+    const uint32_t crc = trailer[0] | trailer[1] << 8 | trailer[2] << 16 | static_cast<uint32_t>(trailer[3]) << 24;
+    const uint32_t size = trailer[4] | trailer[5] << 8 | trailer[6] << 16 | static_cast<uint32_t>(trailer[7]) << 24;
+    if(crc != (m_crc ^ 0xFFFFFFFF) || size != static_cast<uint32_t>(m_totalOutput))
+        return Result::Error;
+    m_bitPosition = 8 * (position + 8);
+    m_state = State::Finished;
+    return Result::Ok;
+}
+
+bool GzipDecoder::readBits(int count, uint32_t& value)
+{
+    if(m_bitPosition + count > 8 * m_size)
+        return false;
+    const auto index = m_bitPosition >> 3;
+    const auto shift = m_bitPosition & 7;
+    uint32_t bits = 0;
+    if(index + 4 <= m_size) {
+        bits = m_data[index] | m_data[index + 1] << 8 | m_data[index + 2] << 16 | static_cast<uint32_t>(m_data[index + 3]) << 24;
+    } else {
+        for(size_t offset = 0; 8 * offset < shift + count; ++offset) {
+            bits |= static_cast<uint32_t>(m_data[index + offset]) << (8 * offset);
+        }
+    }
+
+    value = (bits >> shift) & ((1u << count) - 1);
+    m_bitPosition += count;
+    return true;
+}
+
+GzipDecoder::Result GzipDecoder::decodeSymbol(const Huffman& huffman, int& symbol)
+{
+    const int available = static_cast<int>(std::min<size_t>(15, 8 * m_size - m_bitPosition));
+    uint32_t bits;
+    readBits(available, bits);
+    m_bitPosition -= available;
+    const auto entry = huffman.fast[bits & 511];
+    if(entry && entry >> 9 <= available) {
+        m_bitPosition += entry >> 9;
+        symbol = entry & 511;
+        return Result::Ok;
+    }
+
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for(int length = 1; length <= available; ++length) {
+        code |= bits & 1;
+        bits >>= 1;
+        const int count = huffman.counts[length];
+        if(code - count < first) {
+            m_bitPosition += length;
+            symbol = huffman.symbols[index + (code - first)];
+            return Result::Ok;
+        }
+
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+
+    return available < 15 ? Result::NeedInput : Result::Error;
+}
+
+void GzipDecoder::writeByte(uint8_t value)
+{
+    m_window[m_windowPosition++ & (kWindowSize - 1)] = value;
+    m_output.push_back(value);
+    ++m_totalOutput;
+}
+
+bool GzipDecoder::flush()
+{
+    if(m_output.empty())
+        return true;
+    for(auto value : m_output)
+        m_crc = crc32Table.values[(m_crc ^ static_cast<uint8_t>(value)) & 0xFF] ^ (m_crc >> 8);
+    const auto success = (*m_write)(m_output.data(), m_output.size());
+    m_output.clear();
+    return success;
+}
+
+} // namespace lunasvg
@@ -0,0 +1,79 @@
+#ifndef LUNASVG_GZIP_H
+#define LUNASVG_GZIP_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace lunasvg {
+
+class GzipDecoder {
+public:
+    using WriteFunc = std::function<bool(const char* data, size_t length)>;
+
+    GzipDecoder();
+
+    bool decode(const char* data, size_t length, const WriteFunc& write);
+    bool isFinished() const { return m_state == State::Finished; }
+
+private:
+    enum class State {
+        Header,
+        BlockHeader,
+        Stored,
+        Huffman,
+        Trailer,
+        Finished,
+        Failed
+    };
+
+    enum class Result {
+        Ok,
+        NeedInput,
+        Error
+    };
+
+    struct Huffman {
+        uint16_t counts[16];
+        uint16_t symbols[288];
+        uint16_t fast[512];
+    };
+
+    static int buildHuffman(Huffman& huffman, const uint8_t* lengths, int count);
+
+    Result run();
+    Result readHeader();
+    Result readBlockHeader();
+    Result readDynamicTables();
+    Result copyStored();
+    Result decodeHuffman();
+    Result readTrailer();
+
+    bool readBits(int count, uint32_t& value);
+    Result decodeSymbol(const Huffman& huffman, int& symbol);
+    void writeByte(uint8_t value);
+    bool flush();
+
+    State m_state = State::Header;
+    bool m_finalBlock = false;
+    uint32_t m_storedRemaining = 0;
+    Huffman m_lengthCode;
+    Huffman m_distanceCode;
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_bitPosition = 0;
+    std::vector<uint8_t> m_pending;
+
+    std::vector<uint8_t> m_window;
+    size_t m_windowPosition = 0;
+    uint64_t m_totalOutput = 0;
+    uint32_t m_crc = 0xFFFFFFFF;
+    std::string m_output;
+    const WriteFunc* m_write = nullptr;
+};
+
+} // namespace lunasvg
+
+#endif // LUNASVG_GZIP_H
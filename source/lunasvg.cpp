@@ -3,9 +3,19 @@
 #include "svgrenderstate.h"
 
 #include <cstring>
-#include <fstream>
+#include <cerrno>
 #include <cmath>
 
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 int lunasvg_version()
 {
     return LUNASVG_VERSION;
@@ -416,16 +426,91 @@ SVGElement* Element::element(bool layoutIfNeeded) const
     return element;
 }
 
+class FileData {
+public:
+    explicit FileData(int fd);
+    ~FileData();
+
+    bool isNull() const { return m_data == nullptr; }
+    const char* data() const { return m_data; }
+    size_t length() const { return m_length; }
+
+private:
+    FileData(const FileData&) = delete;
+    FileData& operator=(const FileData&) = delete;
+    const char* m_data = nullptr;
+    size_t m_length = 0;
+    bool m_mapped = false;
+    std::string m_buffer;
+};
+
+FileData::FileData(int fd)
+{
+#ifndef _WIN32
+    struct stat st;
+    if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        auto length = static_cast<size_t>(st.st_size);
+        auto data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data != MAP_FAILED) {
+            m_data = static_cast<const char*>(data);
+            m_length = length;
+            m_mapped = true;
+            return;
+        }
+    }
+#endif
+
+    char buffer[65536];
+#ifdef _WIN32
+    _lseeki64(fd, 0, SEEK_SET);
+    while(true) {
+        auto count = _read(fd, buffer, sizeof(buffer));
+        if(count < 0)
+            return;
+        if(count == 0)
+            break;
+        m_buffer.append(buffer, count);
+    }
+#else
+    bool seekable = true;
+    while(true) {
+        auto count = seekable ? pread(fd, buffer, sizeof(buffer), m_buffer.size()) : read(fd, buffer, sizeof(buffer));
+        if(count < 0 && errno == ESPIPE && seekable && m_buffer.empty()) {
+            seekable = false;
+            continue;
+        }
+
+        if(count < 0 && errno == EINTR)
+            continue;
+        if(count < 0)
+            return;
+        if(count == 0)
+            break;
+        m_buffer.append(buffer, count);
+    }
+#endif
+
+    m_data = m_buffer.data();
+    m_length = m_buffer.size();
+}
+
+FileData::~FileData()
+{
+#ifndef _WIN32
+    if(m_mapped) {
+        munmap(const_cast<char*>(m_data), m_length);
+    }
+#endif
+}
+
 std::unique_ptr<Document> Document::loadFromFile(const std::string& filename)
 {
-    std::ifstream fs;
-    fs.open(filename);
-    if(!fs.is_open())
-        return nullptr;
-    std::string content;
-    std::getline(fs, content, '\0');
-    fs.close();
-    return loadFromData(content);
+    return loadFromFile(filename, ParseOptions());
+}
+
+std::unique_ptr<Document> Document::loadFromFile(int fd)
+{
+    return loadFromFile(fd, ParseOptions());
 }
 
 std::unique_ptr<Document> Document::loadFromData(const std::string& string)
@@ -439,9 +524,53 @@ std::unique_ptr<Document> Document::loadFromData(const char* data)
 }
 
 std::unique_ptr<Document> Document::loadFromData(const char* data, size_t length)
+{
+    return loadFromData(data, length, ParseOptions());
+}
+
+std::unique_ptr<Document> Document::loadFromFile(const std::string& filename, const ParseOptions& options, ParseError* error)
+{
+#ifdef _WIN32
+    auto fd = _open(filename.data(), _O_RDONLY | _O_BINARY);
+#else
+    auto fd = open(filename.data(), O_RDONLY | O_CLOEXEC);
+#endif
+    if(fd == -1) {
+        if(error)
+            *error = ParseError::ReadFailed;
+        return nullptr;
+    }
+
+    auto document = loadFromFile(fd, options, error);
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+    return document;
+}
+
+std::unique_ptr<Document> Document::loadFromFile(int fd, const ParseOptions& options, ParseError* error)
+{
+    if(fd >= 0) {
+        FileData file(fd);
+        if(!file.isNull()) {
+            return loadFromData(file.data(), file.length(), options, error);
+        }
+    }
+
+    if(error)
+        *error = ParseError::ReadFailed;
+    return nullptr;
+}
+
+std::unique_ptr<Document> Document::loadFromData(const char* data, size_t length, const ParseOptions& options, ParseError* error)
 {
     std::unique_ptr<Document> document(new Document);
-    if(!document->parse(data, length))
+    auto result = document->parse(data, length, options);
+    if(error)
+        *error = result;
+    if(result != ParseError::None)
         return nullptr;
     return document;
 }
@@ -464,11 +593,23 @@ Box Document::boundingBox() const
 void Document::updateLayout()
 {
     m_rootElement->layoutIfNeeded();
+    m_rootElement->releaseAttributeText();
 }
 
 void Document::forceLayout()
 {
     m_rootElement->forceLayout();
+    m_rootElement->releaseAttributeText();
+}
+
+void Document::setKeepAttributeText(bool keep)
+{
+    m_rootElement->setKeepAttributeText(keep);
+}
+
+void Document::setLayoutExecutor(ParallelExecutor executor)
+{
+    m_rootElement->setLayoutExecutor(std::move(executor));
 }
 
 void Document::render(Bitmap& bitmap, const Matrix& matrix) const
@@ -527,10 +668,27 @@ SVGRootElement* Document::rootElement(bool layoutIfNeeded) const
     return m_rootElement.get();
 }
 
+std::unique_ptr<Document> Document::clone() const
+{
+    std::unique_ptr<Document> document(new Document);
+    document->m_rootElement = m_rootElement->cloneRoot(document.get());
+    return document;
+}
+
 Document::Document(Document&&) = default;
-Document& Document::operator=(Document&&) = default;
 
-Document::Document() = default;
+Document& Document::operator=(Document&& document)
+{
+    m_rootElement = std::move(document.m_rootElement);
+    m_arena = std::move(document.m_arena);
+    return *this;
+}
+
+Document::Document()
+    : m_arena(new Arena)
+{
+}
+
 Document::~Document() = default;
 
 } // namespace lunasvg
@@ -5,17 +5,22 @@
 #include "svgproperty.h"
 #include "svglayoutstate.h"
 #include "svgrenderstate.h"
+#include "svgparserutils.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
 namespace lunasvg {
 
 ElementID elementid(std::string_view name)
 {
-    static const struct {
-        std::string_view name;
-        ElementID value;
-    } table[] = {
+    static constexpr NameEntry<ElementID> entries[] = {
         {"a", ElementID::G},
         {"circle", ElementID::Circle},
         {"clipPath", ElementID::ClipPath},
@@ -42,10 +47,179 @@ ElementID elementid(std::string_view name)
         {"use", ElementID::Use}
     };
 
-    auto it = std::lower_bound(table, std::end(table), name, [](const auto& item, const auto& name) { return item.name < name; });
-    if(it == std::end(table) || it->name != name)
-        return ElementID::Unknown;
-    return it->value;
+    static constexpr auto table = makeNameTable<128>(entries);
+    static_assert(table.isValid());
+    if(auto entry = table.find(name))
+        return entry->value;
+    return ElementID::Unknown;
+}
+
+static constexpr size_t kMinReleasableLength = 1024;
+
+const std::string* StringPool::intern(std::string_view value)
+{
+    constexpr size_t kMaxInternLength = 64;
+    if(value.length() >= kMinReleasableLength) {
+        auto string = std::make_unique<std::string>(value);
+        const auto* data = string.get();
+        m_releasableStrings.emplace(data, std::move(string));
+        return data;
+    }
+
+    if(value.length() > kMaxInternLength)
+        return &m_strings.emplace_back(value);
+    auto it = m_table.find(value);
+    if(it != m_table.end())
+        return it->second;
+    const auto& string = m_strings.emplace_back(value);
+    m_table.emplace(string, &string);
+    return &string;
+}
+
+void StringPool::release(const std::string* value)
+{
+    m_releasableStrings.erase(value);
+}
+
+size_t SVGElementIdMap::findSlot(std::string_view id, size_t hash) const
+{
+    const auto mask = m_entries.size() - 1;
+    auto index = hash & mask;
+    while(m_entries[index].element && (m_entries[index].hash != hash || m_entries[index].id != id))
+        index = (index + 1) & mask;
+    return index;
+}
+
+SVGElement* SVGElementIdMap::find(std::string_view id) const
+{
+    if(m_size == 0)
+        return nullptr;
+    return m_entries[findSlot(id, std::hash<std::string_view>()(id))].element;
+}
+
+bool SVGElementIdMap::insert(std::string_view id, SVGElement* element)
+{
+    if((m_size + 1) * 2 > m_entries.size())
+        rehash(std::max<size_t>(16, m_entries.size() * 2));
+    const auto hash = std::hash<std::string_view>()(id);
+    auto& entry = m_entries[findSlot(id, hash)];
+    if(entry.element)
+        return false;
+    entry.id.assign(id);
+    entry.hash = hash;
+    entry.element = element;
+    ++m_size;
+    return true;
+}
+
+bool SVGElementIdMap::erase(std::string_view id)
+{
+    if(m_size == 0)
+        return false;
+    const auto mask = m_entries.size() - 1;
+    auto index = findSlot(id, std::hash<std::string_view>()(id));
+    if(m_entries[index].element == nullptr)
+        return false;
+    m_entries[index] = Entry();
+    --m_size;
+    for(auto next = (index + 1) & mask; m_entries[next].element; next = (next + 1) & mask) {
+        if(((next - m_entries[next].hash) & mask) >= ((next - index) & mask)) {
+            m_entries[index] = std::move(m_entries[next]);
+            m_entries[next] = Entry();
+            index = next;
+        }
+    }
+
+    return true;
+}
+
+void SVGElementIdMap::rehash(size_t capacity)
+{
+    auto entries = std::move(m_entries);
+    m_entries.clear();
+    m_entries.resize(capacity);
+    for(auto& entry : entries) {
+        if(entry.element) {
+            m_entries[findSlot(entry.id, entry.hash)] = std::move(entry);
+        }
+    }
+}
+
+Arena::~Arena()
+{
+    while(m_blocks) {
+        auto next = m_blocks->next;
+        std::free(m_blocks);
+        m_blocks = next;
+    }
+}
+
+void* Arena::allocate(size_t size)
+{
+    if(size > kMaxSizeClassSize)
+        return ::operator new(size);
+    const auto index = size == 0 ? 0 : (size - 1) / kSizeClassGranularity;
+    if(auto entry = m_freeLists[index]) {
+        m_freeLists[index] = entry->next;
+        return entry;
+    }
+
+    constexpr auto alignment = kSizeClassGranularity;
+    size = (index + 1) * kSizeClassGranularity;
+    auto ptr = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(m_ptr) + alignment - 1) & ~(alignment - 1));
+    if(m_ptr == nullptr || ptr + size > m_end) {
+        constexpr size_t kMaxBlockSize = 256 * 1024;
+        auto blockSize = std::max(m_blockSize, sizeof(Block) + size + alignment);
+        auto block = static_cast<Block*>(std::malloc(blockSize));
+        if(block == nullptr)
+            throw std::bad_alloc();
+        block->next = m_blocks;
+        m_blocks = block;
+        m_end = reinterpret_cast<char*>(block) + blockSize;
+        m_blockSize = std::min(m_blockSize * 2, kMaxBlockSize);
+        ptr = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(block + 1) + alignment - 1) & ~(alignment - 1));
+    }
+
+    m_ptr = ptr + size;
+    return ptr;
+}
+
+void Arena::deallocate(void* ptr, size_t size)
+{
+    if(size > kMaxSizeClassSize) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    const auto index = size == 0 ? 0 : (size - 1) / kSizeClassGranularity;
+    auto entry = static_cast<FreeEntry*>(ptr);
+    entry->next = m_freeLists[index];
+    m_freeLists[index] = entry;
+}
+
+struct alignas(std::max_align_t) SVGNodeHeader {
+    Arena* arena;
+    size_t size;
+};
+
+void* SVGNode::operator new(size_t size, Document* document)
+{
+    auto arena = document->m_arena.get();
+    auto header = static_cast<SVGNodeHeader*>(arena->allocate(sizeof(SVGNodeHeader) + size));
+    header->arena = arena;
+    header->size = sizeof(SVGNodeHeader) + size;
+    return header + 1;
+}
+
+void SVGNode::operator delete(void* ptr, Document*)
+{
+    operator delete(ptr);
+}
+
+void SVGNode::operator delete(void* ptr)
+{
+    auto header = static_cast<SVGNodeHeader*>(ptr) - 1;
+    header->arena->deallocate(header, header->size);
 }
 
 SVGTextNode::SVGTextNode(Document* document)
@@ -55,67 +229,75 @@ SVGTextNode::SVGTextNode(Document* document)
 
 void SVGTextNode::setData(const std::string& data)
 {
-    rootElement()->setNeedsLayout();
+    if(auto parent = parentElement())
+        parent->setNeedsLayout();
     m_data.assign(data);
 }
 
 std::unique_ptr<SVGNode> SVGTextNode::clone(bool deep) const
 {
-    auto node = std::make_unique<SVGTextNode>(document());
+    auto node = makeSVGNode<SVGTextNode>(document());
     node->setData(m_data);
     return node;
 }
 
+std::unique_ptr<SVGNode> SVGTextNode::cloneInto(Document* document) const
+{
+    auto node = makeSVGNode<SVGTextNode>(document);
+    node->m_data = m_data;
+    return node;
+}
+
 const std::string emptyString;
 
 std::unique_ptr<SVGElement> SVGElement::create(Document* document, ElementID id)
 {
     switch(id) {
     case ElementID::Svg:
-        return std::make_unique<SVGSVGElement>(document);
+        return makeSVGNode<SVGSVGElement>(document);
     case ElementID::Path:
-        return std::make_unique<SVGPathElement>(document);
+        return makeSVGNode<SVGPathElement>(document);
     case ElementID::G:
-        return std::make_unique<SVGGElement>(document);
+        return makeSVGNode<SVGGElement>(document);
     case ElementID::Rect:
-        return std::make_unique<SVGRectElement>(document);
+        return makeSVGNode<SVGRectElement>(document);
     case ElementID::Circle:
-        return std::make_unique<SVGCircleElement>(document);
+        return makeSVGNode<SVGCircleElement>(document);
     case ElementID::Ellipse:
-        return std::make_unique<SVGEllipseElement>(document);
+        return makeSVGNode<SVGEllipseElement>(document);
     case ElementID::Line:
-        return std::make_unique<SVGLineElement>(document);
+        return makeSVGNode<SVGLineElement>(document);
     case ElementID::Defs:
-        return std::make_unique<SVGDefsElement>(document);
+        return makeSVGNode<SVGDefsElement>(document);
     case ElementID::Polygon:
     case ElementID::Polyline:
-        return std::make_unique<SVGPolyElement>(document, id);
+        return makeSVGNode<SVGPolyElement>(document, id);
     case ElementID::Stop:
-        return std::make_unique<SVGStopElement>(document);
+        return makeSVGNode<SVGStopElement>(document);
     case ElementID::LinearGradient:
-        return std::make_unique<SVGLinearGradientElement>(document);
+        return makeSVGNode<SVGLinearGradientElement>(document);
     case ElementID::RadialGradient:
-        return std::make_unique<SVGRadialGradientElement>(document);
+        return makeSVGNode<SVGRadialGradientElement>(document);
     case ElementID::Symbol:
-        return std::make_unique<SVGSymbolElement>(document);
+        return makeSVGNode<SVGSymbolElement>(document);
     case ElementID::Use:
-        return std::make_unique<SVGUseElement>(document);
+        return makeSVGNode<SVGUseElement>(document);
     case ElementID::Pattern:
-        return std::make_unique<SVGPatternElement>(document);
+        return makeSVGNode<SVGPatternElement>(document);
     case ElementID::Mask:
-        return std::make_unique<SVGMaskElement>(document);
+        return makeSVGNode<SVGMaskElement>(document);
     case ElementID::ClipPath:
-        return std::make_unique<SVGClipPathElement>(document);
+        return makeSVGNode<SVGClipPathElement>(document);
     case ElementID::Marker:
-        return std::make_unique<SVGMarkerElement>(document);
+        return makeSVGNode<SVGMarkerElement>(document);
     case ElementID::Image:
-        return std::make_unique<SVGImageElement>(document);
+        return makeSVGNode<SVGImageElement>(document);
     case ElementID::Style:
-        return std::make_unique<SVGStyleElement>(document);
+        return makeSVGNode<SVGStyleElement>(document);
     case ElementID::Text:
-        return std::make_unique<SVGTextElement>(document);
+        return makeSVGNode<SVGTextElement>(document);
     case ElementID::Tspan:
-        return std::make_unique<SVGTSpanElement>(document);
+        return makeSVGNode<SVGTSpanElement>(document);
     default:
         assert(false);
     }
@@ -126,6 +308,9 @@ std::unique_ptr<SVGElement> SVGElement::create(Document* document, ElementID id)
 SVGElement::SVGElement(Document* document, ElementID id)
     : SVGNode(document)
     , m_id(id)
+    , m_attributes(arena())
+    , m_properties(arena())
+    , m_children(arena())
 {
 }
 
@@ -137,12 +322,26 @@ bool SVGElement::hasAttribute(std::string_view name) const
     return hasAttribute(id);
 }
 
+SVGElement::~SVGElement()
+{
+    if(m_releaseCandidate) {
+        rootElement()->removeReleaseCandidate(this);
+    }
+}
+
 const std::string& SVGElement::getAttribute(std::string_view name) const
 {
     auto id = propertyid(name);
     if(id == PropertyID::Unknown)
         return emptyString;
-    return getAttribute(id);
+    auto attribute = findAttribute(id);
+    if(attribute == nullptr)
+        return emptyString;
+    if(!attribute->isReleased())
+        return attribute->value();
+    if(m_regeneratedAttribute == nullptr)
+        m_regeneratedAttribute = std::make_unique<std::string>(regenerateAttribute(id));
+    return *m_regeneratedAttribute;
 }
 
 bool SVGElement::setAttribute(std::string_view name, const std::string& value)
@@ -150,76 +349,154 @@ bool SVGElement::setAttribute(std::string_view name, const std::string& value)
     auto id = propertyid(name);
     if(id == PropertyID::Unknown)
         return false;
-    return setAttribute(0x1000, id, value);
+    if(id == PropertyID::Id) {
+        const std::string oldId(getAttribute(PropertyID::Id));
+        if(!setAttribute(Attribute(0x1000, id, value)))
+            return false;
+        rootElement()->changeElementId(this, oldId, getAttribute(PropertyID::Id));
+        rootElement()->updateUseElements(this, id, oldId);
+        return true;
+    }
+
+    if(!setAttribute(Attribute(0x1000, id, value)))
+        return false;
+    rootElement()->updateUseElements(this, id, std::string_view());
+    return true;
 }
 
-const Attribute* SVGElement::findAttribute(PropertyID id) const
+static AttributeList::const_iterator lowerBoundAttribute(const AttributeList& attributes, PropertyID id)
 {
-    for(const auto& attribute : m_attributes) {
-        if(id == attribute.id()) {
-            return &attribute;
-        }
-    }
+    return std::lower_bound(attributes.begin(), attributes.end(), id, [](const auto& attribute, auto id) { return attribute.id() < id; });
+}
 
-    return nullptr;
+const Attribute* SVGElement::findAttribute(PropertyID id) const
+{
+    auto it = lowerBoundAttribute(m_attributes, id);
+    if(it == m_attributes.end() || it->id() != id)
+        return nullptr;
+    return &*it;
 }
 
 bool SVGElement::hasAttribute(PropertyID id) const
 {
-    for(const auto& attribute : m_attributes) {
-        if(id == attribute.id()) {
-            return true;
-        }
-    }
-
-    return false;
+    return findAttribute(id) != nullptr;
 }
 
 const std::string& SVGElement::getAttribute(PropertyID id) const
 {
-    for(const auto& attribute : m_attributes) {
-        if(id == attribute.id()) {
-            return attribute.value();
+    auto attribute = findAttribute(id);
+    if(attribute == nullptr)
+        return emptyString;
+    return attribute->value();
+}
+
+bool SVGElement::setAttribute(int specificity, PropertyID id, const std::string& value)
+{
+    auto attribute = findAttribute(id);
+    if(attribute && specificity < attribute->specificity())
+        return false;
+    return setAttribute(Attribute(specificity, id, rootElement()->internString(value)));
+}
+
+void SVGElement::setAttributes(const AttributeList& attributes)
+{
+    for(const auto& attribute : attributes) {
+        setAttribute(attribute);
+    }
+}
+
+bool SVGElement::setAttribute(Attribute attribute)
+{
+    auto it = lowerBoundAttribute(m_attributes, attribute.id());
+    auto index = it - m_attributes.begin();
+    if(it != m_attributes.end() && it->id() == attribute.id()) {
+        if(attribute.specificity() < it->specificity())
+            return false;
+        auto& oldAttribute = m_attributes[index];
+        if(oldAttribute.isReleased())
+            m_regeneratedAttribute.reset();
+        if(!oldAttribute.isParsed()) {
+            // Parse the overridden value first, so an invalid override keeps it.
+            oldAttribute.setParsed(true);
+            parseAttribute(oldAttribute.id(), oldAttribute.value());
         }
+
+        m_attributes[index] = std::move(attribute);
+    } else {
+        m_attributes.insert(it, std::move(attribute));
+    }
+
+    auto& newAttribute = m_attributes[index];
+    trackReleasableAttribute(newAttribute);
+    auto rootElement = this->rootElement();
+    if(rootElement && rootElement->deferAttributeParsing()) {
+        newAttribute.setParsed(false);
+        m_needsAttributeParse = true;
+    } else {
+        newAttribute.setParsed(true);
+        parseAttribute(newAttribute.id(), newAttribute.value());
     }
 
-    return emptyString;
+    setNeedsLayout();
+    return true;
 }
 
-bool SVGElement::setAttribute(int specificity, PropertyID id, const std::string& value)
+void SVGElement::parseAttribute(PropertyID id, const std::string& value)
 {
+    if(auto property = getProperty(id)) {
+        property->parse(value);
+    }
+}
+
+void SVGElement::parseAttributesIfNeeded()
+{
+    if(!m_needsAttributeParse)
+        return;
+    m_needsAttributeParse = false;
     for(auto& attribute : m_attributes) {
-        if(id == attribute.id()) {
-            if(specificity < attribute.specificity())
-                return false;
-            parseAttribute(id, value);
-            attribute = Attribute(specificity, id, value);
-            return true;
+        if(!attribute.isParsed()) {
+            attribute.setParsed(true);
+            parseAttribute(attribute.id(), attribute.value());
         }
     }
+}
 
-    parseAttribute(id, value);
-    m_attributes.emplace_front(specificity, id, value);
-    return true;
+void SVGElement::releaseAttribute(const std::string* value)
+{
+    for(auto& attribute : m_attributes) {
+        if(&attribute.value() == value) {
+            attribute = Attribute(attribute.specificity(), attribute.id(), &emptyString);
+            attribute.setParsed(true);
+            attribute.setReleased(true);
+        }
+    }
 }
 
-void SVGElement::setAttributes(const AttributeList& attributes)
+void SVGElement::trackReleasableAttribute(const Attribute& attribute)
 {
-    for(const auto& attribute : attributes) {
-        setAttribute(attribute);
+    if(m_releaseCandidate || attribute.isReleased() || attribute.value().length() < kMinReleasableLength || !isReleasableAttribute(attribute.id()))
+        return;
+    if(auto rootElement = this->rootElement()) {
+        rootElement->addReleaseCandidate(this);
     }
 }
 
-bool SVGElement::setAttribute(const Attribute& attribute)
+bool SVGElement::hasReleasableAttribute() const
 {
-    return setAttribute(attribute.specificity(), attribute.id(), attribute.value());
+    for(const auto& attribute : m_attributes) {
+        if(!attribute.isReleased() && attribute.value().length() >= kMinReleasableLength && isReleasableAttribute(attribute.id())) {
+            return true;
+        }
+    }
+
+    return false;
 }
 
-void SVGElement::parseAttribute(PropertyID id, const std::string& value)
+void SVGElement::setAttributeParsed(PropertyID id)
 {
-    rootElement()->setNeedsLayout();
-    if(auto property = getProperty(id)) {
-        property->parse(value);
+    auto it = lowerBoundAttribute(m_attributes, id);
+    if(it != m_attributes.end() && it->id() == id) {
+        m_attributes[it - m_attributes.begin()].setParsed(true);
     }
 }
 
@@ -272,6 +549,11 @@ SVGNode* SVGElement::addChild(std::unique_ptr<SVGNode> child)
     return &*m_children.back();
 }
 
+void SVGElement::removeChild(const SVGNode* child)
+{
+    m_children.remove_if([child](const auto& node) { return node.get() == child; });
+}
+
 SVGNode* SVGElement::firstChild() const
 {
     if(m_children.empty())
@@ -288,30 +570,32 @@ SVGNode* SVGElement::lastChild() const
 
 Rect SVGElement::fillBoundingBox() const
 {
-    auto fillBoundingBox = Rect::Invalid;
+    if(m_fillBoundingBox.isValid())
+        return m_fillBoundingBox;
     for(const auto& child : m_children) {
         if(auto element = toSVGElement(child); element && !element->isHiddenElement()) {
-            fillBoundingBox.unite(element->localTransform().mapRect(element->fillBoundingBox()));
+            m_fillBoundingBox.unite(element->localTransform().mapRect(element->fillBoundingBox()));
         }
     }
 
-    if(!fillBoundingBox.isValid())
-        fillBoundingBox = Rect::Empty;
-    return fillBoundingBox;
+    if(!m_fillBoundingBox.isValid())
+        m_fillBoundingBox = Rect::Empty;
+    return m_fillBoundingBox;
 }
 
 Rect SVGElement::strokeBoundingBox() const
 {
-    auto strokeBoundingBox = Rect::Invalid;
+    if(m_strokeBoundingBox.isValid())
+        return m_strokeBoundingBox;
     for(const auto& child : m_children) {
         if(auto element = toSVGElement(child); element && !element->isHiddenElement()) {
-            strokeBoundingBox.unite(element->localTransform().mapRect(element->strokeBoundingBox()));
+            m_strokeBoundingBox.unite(element->localTransform().mapRect(element->strokeBoundingBox()));
         }
     }
 
-    if(!strokeBoundingBox.isValid())
-        strokeBoundingBox = Rect::Empty;
-    return strokeBoundingBox;
+    if(!m_strokeBoundingBox.isValid())
+        m_strokeBoundingBox = Rect::Empty;
+    return m_strokeBoundingBox;
 }
 
 Rect SVGElement::paintBoundingBox() const
@@ -326,35 +610,62 @@ Rect SVGElement::paintBoundingBox() const
     return m_paintBoundingBox;
 }
 
-SVGMarkerElement* SVGElement::getMarker(std::string_view id) const
+SVGElement* SVGElement::resolveReference(SVGReference& reference, std::string_view id)
 {
-    auto element = rootElement()->getElementById(id);
-    if(element && element->id() == ElementID::Marker)
+    if(id == reference.id)
+        return reference.element;
+    reference.id.assign(id);
+    reference.element = nullptr;
+    if(!id.empty()) {
+        auto rootElement = this->rootElement();
+        reference.element = rootElement->getElementById(id);
+        rootElement->addReferenceDependency(id, this, &reference);
+    }
+
+    return reference.element;
+}
+
+SVGMarkerElement* SVGElement::getMarker(SVGReference& reference, std::string_view id)
+{
+    auto element = resolveReference(reference, id);
+    if(element && element->id() == ElementID::Marker) {
+        element->parseAttributesIfNeeded();
         return static_cast<SVGMarkerElement*>(element);
+    }
+
     return nullptr;
 }
 
-SVGClipPathElement* SVGElement::getClipper(std::string_view id) const
+SVGClipPathElement* SVGElement::getClipper(SVGReference& reference, std::string_view id)
 {
-    auto element = rootElement()->getElementById(id);
-    if(element && element->id() == ElementID::ClipPath)
+    auto element = resolveReference(reference, id);
+    if(element && element->id() == ElementID::ClipPath) {
+        element->parseAttributesIfNeeded();
         return static_cast<SVGClipPathElement*>(element);
+    }
+
     return nullptr;
 }
 
-SVGMaskElement* SVGElement::getMasker(std::string_view id) const
+SVGMaskElement* SVGElement::getMasker(SVGReference& reference, std::string_view id)
 {
-    auto element = rootElement()->getElementById(id);
-    if(element && element->id() == ElementID::Mask)
+    auto element = resolveReference(reference, id);
+    if(element && element->id() == ElementID::Mask) {
+        element->parseAttributesIfNeeded();
         return static_cast<SVGMaskElement*>(element);
+    }
+
     return nullptr;
 }
 
-SVGPaintElement* SVGElement::getPainter(std::string_view id) const
+SVGPaintElement* SVGElement::getPainter(SVGReference& reference, std::string_view id)
 {
-    auto element = rootElement()->getElementById(id);
-    if(element && element->isPaintElement())
+    auto element = resolveReference(reference, id);
+    if(element && element->isPaintElement()) {
+        element->parseAttributesIfNeeded();
         return static_cast<SVGPaintElement*>(element);
+    }
+
     return nullptr;
 }
 
@@ -434,12 +745,42 @@ void SVGElement::cloneChildren(SVGElement* parentElement) const
 
 std::unique_ptr<SVGNode> SVGElement::clone(bool deep) const
 {
+    const_cast<SVGElement*>(this)->parseAttributesIfNeeded();
     auto element = SVGElement::create(document(), m_id);
-    element->setAttributes(m_attributes);
-    if(deep) { cloneChildren(element.get()); }
+    copyInto(element.get());
+    if(deep && m_id != ElementID::Use)
+        cloneChildren(element.get());
+    return element;
+}
+
+std::unique_ptr<SVGNode> SVGElement::cloneInto(Document* document) const
+{
+    auto element = SVGElement::create(document, m_id);
+    copyInto(element.get());
+    for(const auto& child : m_children) {
+        element->addChild(child->cloneInto(document));
+    }
+
     return element;
 }
 
+void SVGElement::copyInto(SVGElement* element) const
+{
+    assert(element->m_id == m_id);
+    element->m_attributes.assign(m_attributes.begin(), m_attributes.end());
+    element->m_needsAttributeParse = m_needsAttributeParse;
+    for(const auto& attribute : element->m_attributes) {
+        element->trackReleasableAttribute(attribute);
+    }
+
+    auto it = element->m_properties.begin();
+    for(auto property : m_properties) {
+        assert(property->id() == (*it)->id());
+        (*it)->copyFrom(*property);
+        ++it;
+    }
+}
+
 void SVGElement::build()
 {
     for(const auto& child : m_children) {
@@ -451,9 +792,11 @@ void SVGElement::build()
 
 void SVGElement::layoutElement(const SVGLayoutState& state)
 {
+    m_fillBoundingBox = Rect::Invalid;
+    m_strokeBoundingBox = Rect::Invalid;
     m_paintBoundingBox = Rect::Invalid;
-    m_clipper = getClipper(state.clip_path());
-    m_masker = getMasker(state.mask());
+    m_clipper = getClipper(m_clipperReference, state.clip_path());
+    m_masker = getMasker(m_maskerReference, state.mask());
     m_opacity = state.opacity();
 
     m_font_size = state.font_size();
@@ -463,8 +806,20 @@ void SVGElement::layoutElement(const SVGLayoutState& state)
     m_pointer_events = state.pointer_events();
 }
 
+constexpr size_t kMinParallelLayoutChildren = 1024;
+constexpr size_t kParallelLayoutBatchSize = 256;
+
+static thread_local bool isParallelLayoutTask = false;
+
 void SVGElement::layoutChildren(SVGLayoutState& state)
 {
+    if(m_children.size() >= kMinParallelLayoutChildren && !isParallelLayoutTask) {
+        if(const auto& executor = rootElement()->layoutExecutor()) {
+            layoutChildrenInParallel(state, executor);
+            return;
+        }
+    }
+
     for(const auto& child : m_children) {
         if(auto element = toSVGElement(child)) {
             element->layout(state);
@@ -472,13 +827,92 @@ void SVGElement::layoutChildren(SVGLayoutState& state)
     }
 }
 
+void SVGElement::layoutChildrenInParallel(SVGLayoutState& state, const ParallelExecutor& executor)
+{
+    std::vector<SVGElement*> elements;
+    elements.reserve(m_children.size());
+    for(const auto& child : m_children) {
+        if(auto element = toSVGElement(child)) {
+            elements.push_back(element);
+        }
+    }
+
+    rootElement()->parseReferenceTargets();
+    const auto batchCount = (elements.size() + kParallelLayoutBatchSize - 1) / kParallelLayoutBatchSize;
+    executor(batchCount, [&elements, &state](size_t index) {
+        const auto wasParallelLayoutTask = isParallelLayoutTask;
+        isParallelLayoutTask = true;
+        SVGLayoutState batchState(state);
+        const auto begin = index * kParallelLayoutBatchSize;
+        const auto end = std::min(begin + kParallelLayoutBatchSize, elements.size());
+        for(auto i = begin; i < end; ++i)
+            elements[i]->layout(batchState);
+        isParallelLayoutTask = wasParallelLayoutTask;
+    });
+}
+
 void SVGElement::layout(SVGLayoutState& state)
 {
+    m_needsLayout = false;
+    m_childNeedsLayout = false;
+    parseAttributesIfNeeded();
     SVGLayoutState newState(state, this);
     layoutElement(newState);
     layoutChildren(newState);
 }
 
+static SVGElement* layoutRootElement(SVGElement* element)
+{
+    auto layoutRoot = element;
+    for(auto current = element; current; current = current->parentElement()) {
+        switch(current->id()) {
+        case ElementID::ClipPath:
+        case ElementID::Mask:
+        case ElementID::Marker:
+            return current->rootElement();
+        case ElementID::Text:
+            layoutRoot = current;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return layoutRoot;
+}
+
+void SVGElement::setNeedsLayout()
+{
+    if(rootElement()->needsLayout())
+        return;
+    auto element = layoutRootElement(this);
+    element->m_needsLayout = true;
+    for(auto parent = element->parentElement(); parent; parent = parent->parentElement()) {
+        parent->m_childNeedsLayout = true;
+        parent->m_fillBoundingBox = Rect::Invalid;
+        parent->m_strokeBoundingBox = Rect::Invalid;
+        parent->m_paintBoundingBox = Rect::Invalid;
+    }
+}
+
+void SVGElement::updateLayout(SVGLayoutState& state)
+{
+    if(m_needsLayout) {
+        layout(state);
+        return;
+    }
+
+    if(!m_childNeedsLayout)
+        return;
+    m_childNeedsLayout = false;
+    SVGLayoutState newState(state, this);
+    for(const auto& child : m_children) {
+        if(auto element = toSVGElement(child)) {
+            element->updateLayout(newState);
+        }
+    }
+}
+
 void SVGElement::renderChildren(SVGRenderState& state) const
 {
     for(const auto& child : m_children) {
@@ -596,11 +1030,11 @@ SVGGraphicsElement::SVGGraphicsElement(Document* document, ElementID id)
     addProperty(m_transform);
 }
 
-SVGPaintServer SVGGraphicsElement::getPaintServer(const Paint& paint, float opacity) const
+SVGPaintServer SVGGraphicsElement::getPaintServer(SVGReference& reference, const Paint& paint, float opacity)
 {
     if(paint.isNone())
         return SVGPaintServer();
-    if(auto element = getPainter(paint.id()))
+    if(auto element = getPainter(reference, paint.id()))
         return SVGPaintServer(element, paint.color(), opacity);
     return SVGPaintServer(nullptr, paint.color(), opacity);
 }
@@ -673,62 +1107,406 @@ void SVGSVGElement::render(SVGRenderState& state) const
 
 SVGRootElement::SVGRootElement(Document* document)
     : SVGSVGElement(document)
+    , m_stringPool(std::make_shared<StringPool>())
 {
 }
 
+SVGRootElement::~SVGRootElement()
+{
+    for(auto element : m_releaseCandidates) {
+        element->setReleaseCandidate(false);
+    }
+}
+
+static void mapClonedElements(const SVGElement* element, SVGElement* clonedElement, std::unordered_map<const SVGElement*, SVGElement*>& elements)
+{
+    elements.emplace(element, clonedElement);
+    auto it = clonedElement->children().begin();
+    for(const auto& child : element->children()) {
+        if(auto childElement = toSVGElement(child))
+            mapClonedElements(childElement, toSVGElement(*it), elements);
+        ++it;
+    }
+}
+
+std::unique_ptr<SVGRootElement> SVGRootElement::cloneRoot(Document* document) const
+{
+    auto rootElement = makeSVGNode<SVGRootElement>(document);
+    copyInto(rootElement.get());
+    for(const auto& child : children()) {
+        rootElement->addChild(child->cloneInto(document));
+    }
+
+    rootElement->m_styleSheets = m_styleSheets;
+    rootElement->m_sharedStringPools = m_sharedStringPools;
+    rootElement->m_sharedStringPools.push_back(m_stringPool);
+    rootElement->m_keepAttributeText = m_keepAttributeText;
+    rootElement->m_deferAttributeParsing = m_deferAttributeParsing;
+    rootElement->m_layoutExecutor = m_layoutExecutor;
+    rootElement->m_countedImages = m_countedImages;
+    rootElement->m_maxImagePixels = m_maxImagePixels;
+    rootElement->m_imagePixelCount = m_imagePixelCount;
+    if(!m_idCache.empty() || !m_useElements.empty()) {
+        std::unordered_map<const SVGElement*, SVGElement*> elements;
+        mapClonedElements(this, rootElement.get(), elements);
+        m_idCache.forEach([&](const std::string& id, SVGElement* element) {
+            rootElement->m_idCache.insert(id, elements.at(element));
+        });
+
+        for(auto useElement : m_useElements) {
+            auto clonedElement = static_cast<SVGUseElement*>(elements.at(useElement));
+            if(auto instanceElement = useElement->instanceElement())
+                clonedElement->setInstanceElement(elements.at(instanceElement));
+            rootElement->m_useElements.push_back(clonedElement);
+        }
+    }
+
+    return rootElement;
+}
+
 SVGRootElement* SVGRootElement::layoutIfNeeded()
 {
-    if(needsLayout())
+    if(needsLayout()) {
         forceLayout();
+    } else if(childNeedsLayout()) {
+        SVGLayoutState state;
+        updateLayout(state);
+        updateIntrinsicSize();
+    }
+
     return this;
 }
 
+const std::string* SVGRootElement::internString(std::string_view value)
+{
+    return m_stringPool->intern(value);
+}
+
+static size_t countInstanceElements(const SVGElement* element)
+{
+    size_t count = 1;
+    if(element->id() == ElementID::Use)
+        return count;
+    for(const auto& child : element->children()) {
+        if(auto childElement = toSVGElement(child.get())) {
+            count += countInstanceElements(childElement);
+        }
+    }
+
+    return count;
+}
+
+bool SVGRootElement::addUseExpansion(const SVGElement* targetElement)
+{
+    if(m_maxUseExpansion == 0)
+        return true;
+    if(m_useExpansionCount <= m_maxUseExpansion)
+        m_useExpansionCount += countInstanceElements(targetElement);
+    return m_useExpansionCount <= m_maxUseExpansion;
+}
+
+void SVGRootElement::removeUseExpansion(size_t count)
+{
+    if(m_maxUseExpansion > 0) {
+        m_useExpansionCount -= std::min(count, m_useExpansionCount);
+    }
+}
+
+bool SVGRootElement::addImagePixels(const Bitmap& image)
+{
+    if(m_maxImagePixels == 0 || !m_countedImages.insert(image.data()).second)
+        return true;
+    const auto pixels = static_cast<size_t>(image.width()) * image.height();
+    if(m_imagePixelCount + pixels > m_maxImagePixels) {
+        m_countedImages.erase(image.data());
+        return false;
+    }
+
+    m_imagePixelCount += pixels;
+    return true;
+}
+
+void SVGRootElement::setKeepAttributeText(bool keep)
+{
+    if(keep == m_keepAttributeText)
+        return;
+    m_keepAttributeText = keep;
+    if(keep) {
+        for(auto element : m_releaseCandidates)
+            element->setReleaseCandidate(false);
+        m_releaseCandidates.clear();
+        return;
+    }
+
+    transverse([](SVGElement* element) {
+        for(const auto& attribute : element->attributes()) {
+            element->trackReleasableAttribute(attribute);
+        }
+    });
+}
+
+void SVGRootElement::addReleaseCandidate(SVGElement* element)
+{
+    if(m_keepAttributeText)
+        return;
+    element->setReleaseCandidate(true);
+    m_releaseCandidates.insert(element);
+}
+
+void SVGRootElement::releaseAttributeText()
+{
+    if(m_releaseCandidates.empty() || !m_sharedStringPools.empty() || m_stringPool.use_count() > 1)
+        return;
+    struct Candidate {
+        bool releasable = true;
+        std::vector<SVGElement*> elements;
+    };
+
+    std::unordered_map<const std::string*, Candidate> candidates;
+    for(auto element : m_releaseCandidates) {
+        for(const auto& attribute : element->attributes()) {
+            if(attribute.isReleased() || attribute.value().length() < kMinReleasableLength || !element->isReleasableAttribute(attribute.id()))
+                continue;
+            auto& candidate = candidates[&attribute.value()];
+            candidate.releasable &= attribute.isParsed() && element->canReleaseAttribute(attribute.id());
+            candidate.elements.push_back(element);
+        }
+    }
+
+    for(const auto& [value, candidate] : candidates) {
+        if(!candidate.releasable)
+            continue;
+        for(auto element : candidate.elements)
+            element->releaseAttribute(value);
+        m_stringPool->release(value);
+    }
+
+    for(auto it = m_releaseCandidates.begin(); it != m_releaseCandidates.end();) {
+        if((*it)->hasReleasableAttribute()) {
+            ++it;
+        } else {
+            (*it)->setReleaseCandidate(false);
+            it = m_releaseCandidates.erase(it);
+        }
+    }
+}
+
 SVGElement* SVGRootElement::getElementById(std::string_view id) const
 {
-    auto it = m_idCache.find(id);
-    if(it == m_idCache.end())
+    return m_idCache.find(id);
+}
+
+void SVGRootElement::addElementById(std::string_view id, SVGElement* element)
+{
+    m_idCache.insert(id, element);
+}
+
+static SVGElement* findElementById(SVGElement* element, std::string_view id, const SVGElement* excludedElement)
+{
+    if(element != excludedElement && element->getAttribute(PropertyID::Id) == id)
+        return element;
+    if(element->id() == ElementID::Use) {
+        // The clones under a <use> keep their target's id but are not addressable by it.
         return nullptr;
-    return it->second;
+    }
+
+    for(const auto& child : element->children()) {
+        auto childElement = toSVGElement(child);
+        if(childElement == nullptr)
+            continue;
+        if(auto foundElement = findElementById(childElement, id, excludedElement)) {
+            return foundElement;
+        }
+    }
+
+    return nullptr;
 }
 
-void SVGRootElement::addElementById(const std::string& id, SVGElement* element)
+void SVGRootElement::changeElementId(SVGElement* element, std::string_view oldId, std::string_view newId)
 {
-    m_idCache.emplace(id, element);
+    if(oldId == newId)
+        return;
+    if(!oldId.empty() && m_idCache.find(oldId) == element) {
+        m_idCache.erase(oldId);
+        if(auto nextElement = findElementById(this, oldId, element))
+            m_idCache.insert(oldId, nextElement);
+        invalidateReferences(oldId);
+    }
+
+    if(newId.empty())
+        return;
+    auto firstElement = findElementById(this, newId, nullptr);
+    if(firstElement != m_idCache.find(newId)) {
+        m_idCache.erase(newId);
+        if(firstElement)
+            m_idCache.insert(newId, firstElement);
+        invalidateReferences(newId);
+    }
 }
 
-void SVGRootElement::layout(SVGLayoutState& state)
+void SVGRootElement::parseReferenceTargets()
 {
-    SVGSVGElement::layout(state);
+    m_idCache.forEach([](const std::string&, SVGElement* element) {
+        element->parseAttributesIfNeeded();
+    });
+}
 
+void SVGRootElement::addReferenceDependency(std::string_view id, SVGElement* element, SVGReference* reference)
+{
+    std::lock_guard<std::mutex> lock(m_referenceDependenciesMutex);
+    auto& dependencies = m_referenceDependencies[std::string(id)];
+    if(!dependencies.empty() && dependencies.back().reference == reference)
+        return;
+    dependencies.push_back({element, reference});
+    const auto size = dependencies.size();
+    if(size >= 64 && (size & (size - 1)) == 0) {
+        auto isStale = [id](const auto& dependency) { return dependency.reference->id != id; };
+        dependencies.erase(std::remove_if(dependencies.begin(), dependencies.end(), isStale), dependencies.end());
+        std::sort(dependencies.begin(), dependencies.end(), [](const auto& a, const auto& b) { return a.reference < b.reference; });
+        auto isSame = [](const auto& a, const auto& b) { return a.reference == b.reference; };
+        dependencies.erase(std::unique(dependencies.begin(), dependencies.end(), isSame), dependencies.end());
+    }
+}
+
+static void findUseElements(SVGElement* element, std::vector<SVGUseElement*>& useElements)
+{
+    for(const auto& child : element->children()) {
+        auto childElement = toSVGElement(child);
+        if(childElement == nullptr)
+            continue;
+        if(childElement->id() == ElementID::Use) {
+            // The <use> elements inside an instance are rebuilt along with it.
+            useElements.push_back(static_cast<SVGUseElement*>(childElement));
+        } else {
+            findUseElements(childElement, useElements);
+        }
+    }
+}
+
+void SVGRootElement::collectUseElements()
+{
+    m_useElements.clear();
+    findUseElements(this, m_useElements);
+}
+
+static bool containsElement(const SVGElement* element, const SVGElement* descendantElement)
+{
+    for(auto current = descendantElement; current; current = current->parentElement()) {
+        if(current == element) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void SVGRootElement::updateUseElements(const SVGElement* element, PropertyID id, std::string_view oldId)
+{
+    if(m_useElements.empty())
+        return;
+    auto needsRebuild = [&](SVGUseElement* useElement, const SVGElement* changedElement) {
+        if(useElement == changedElement)
+            return id == PropertyID::Href || id == PropertyID::Width || id == PropertyID::Height;
+        useElement->parseAttributesIfNeeded();
+        if(changedElement == element && id == PropertyID::Id) {
+            std::string_view href(useElement->hrefString());
+            if(!href.empty() && href.front() == '#' && href.substr(1) == oldId) {
+                return true;
+            }
+        }
+
+        auto targetElement = useElement->getTargetElement(document());
+        return targetElement && containsElement(targetElement, changedElement);
+    };
+
+    // A rebuilt <use> changes the subtree of every ancestor, so repeat until no target contains one.
+    std::vector<SVGUseElement*> useElements(m_useElements);
+    std::vector<const SVGElement*> changedElements(1, element);
+    std::unordered_set<const SVGElement*> removedElements;
+    for(size_t index = 0; index < changedElements.size() && !useElements.empty(); ++index) {
+        auto changedElement = changedElements[index];
+        auto end = std::remove_if(useElements.begin(), useElements.end(), [&](SVGUseElement* useElement) {
+            if(!needsRebuild(useElement, changedElement))
+                return false;
+            useElement->rebuild(removedElements);
+            changedElements.push_back(useElement);
+            return true;
+        });
+
+        useElements.erase(end, useElements.end());
+    }
+
+    if(!removedElements.empty()) {
+        removeReferenceDependencies(removedElements);
+    }
+}
+
+void SVGRootElement::removeReferenceDependencies(const std::unordered_set<const SVGElement*>& elements)
+{
+    std::lock_guard<std::mutex> lock(m_referenceDependenciesMutex);
+    for(auto it = m_referenceDependencies.begin(); it != m_referenceDependencies.end();) {
+        auto& dependencies = it->second;
+        auto isRemoved = [&elements](const auto& dependency) { return elements.count(dependency.element) > 0; };
+        dependencies.erase(std::remove_if(dependencies.begin(), dependencies.end(), isRemoved), dependencies.end());
+        if(dependencies.empty()) {
+            it = m_referenceDependencies.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SVGRootElement::invalidateReferences(std::string_view id)
+{
+    auto it = m_referenceDependencies.find(std::string(id));
+    if(it == m_referenceDependencies.end())
+        return;
+    auto dependencies = std::move(it->second);
+    m_referenceDependencies.erase(it);
+    for(const auto& dependency : dependencies) {
+        if(dependency.reference->id == id) {
+            *dependency.reference = SVGReference();
+            dependency.element->setNeedsLayout();
+        }
+    }
+}
+
+bool SVGRootElement::computeIntrinsicSize(float& intrinsicWidth, float& intrinsicHeight) const
+{
     LengthContext lengthContext(this);
     if(!width().isPercent()) {
-        m_intrinsicWidth = lengthContext.valueForLength(width());
+        intrinsicWidth = lengthContext.valueForLength(width());
     } else {
-        m_intrinsicWidth = 0.f;
+        intrinsicWidth = 0.f;
     }
 
     if(!height().isPercent()) {
-        m_intrinsicHeight = lengthContext.valueForLength(height());
+        intrinsicHeight = lengthContext.valueForLength(height());
     } else {
-        m_intrinsicHeight = 0.f;
+        intrinsicHeight = 0.f;
     }
 
     const auto& viewBoxRect = viewBox().value();
-    if(!viewBoxRect.isEmpty() && (!m_intrinsicWidth || !m_intrinsicHeight)) {
+    if(!viewBoxRect.isEmpty() && (!intrinsicWidth || !intrinsicHeight)) {
         auto intrinsicRatio = viewBoxRect.w / viewBoxRect.h;
-        if(!m_intrinsicWidth && m_intrinsicHeight)
-            m_intrinsicWidth = m_intrinsicHeight * intrinsicRatio;
-        else if(m_intrinsicWidth && !m_intrinsicHeight) {
-            m_intrinsicHeight = m_intrinsicWidth / intrinsicRatio;
+        if(!intrinsicWidth && intrinsicHeight)
+            intrinsicWidth = intrinsicHeight * intrinsicRatio;
+        else if(intrinsicWidth && !intrinsicHeight) {
+            intrinsicHeight = intrinsicWidth / intrinsicRatio;
         }
     }
 
-    if(viewBoxRect.isValid() && (!m_intrinsicWidth || !m_intrinsicHeight)) {
-        m_intrinsicWidth = viewBoxRect.w;
-        m_intrinsicHeight = viewBoxRect.h;
+    if(viewBoxRect.isValid() && (!intrinsicWidth || !intrinsicHeight)) {
+        intrinsicWidth = viewBoxRect.w;
+        intrinsicHeight = viewBoxRect.h;
     }
 
-    if(!m_intrinsicWidth || !m_intrinsicHeight) {
+    return intrinsicWidth && intrinsicHeight;
+}
+
+void SVGRootElement::updateIntrinsicSize()
+{
+    if(!computeIntrinsicSize(m_intrinsicWidth, m_intrinsicHeight)) {
         auto boundingBox = paintBoundingBox();
         if(!m_intrinsicWidth)
             m_intrinsicWidth = boundingBox.right();
@@ -738,6 +1516,12 @@ void SVGRootElement::layout(SVGLayoutState& state)
     }
 }
 
+void SVGRootElement::layout(SVGLayoutState& state)
+{
+    SVGSVGElement::layout(state);
+    updateIntrinsicSize();
+}
+
 void SVGRootElement::forceLayout()
 {
     SVGLayoutState state;
@@ -782,13 +1566,50 @@ void SVGUseElement::render(SVGRenderState& state) const
 
 void SVGUseElement::build()
 {
+    // Each <use> gets its own copy of the target subtree. The copies reuse the target's parsed
+    // properties and path buffers, but not its nodes: layout results such as inherited paint
+    // and stroke are stored on the nodes, so instances cannot share them.
+    addInstanceElement();
+    SVGGraphicsElement::build();
+}
+
+static size_t collectInstanceElements(const SVGElement* element, std::unordered_set<const SVGElement*>& elements)
+{
+    size_t count = 1;
+    elements.insert(element);
+    for(const auto& child : element->children()) {
+        if(auto childElement = toSVGElement(child.get())) {
+            count += collectInstanceElements(childElement, elements);
+        }
+    }
+
+    return count;
+}
+
+void SVGUseElement::rebuild(std::unordered_set<const SVGElement*>& removedElements)
+{
+    if(m_instanceElement) {
+        rootElement()->removeUseExpansion(collectInstanceElements(m_instanceElement, removedElements));
+        removeChild(m_instanceElement);
+        m_instanceElement = nullptr;
+    }
+
+    if(auto instanceElement = addInstanceElement())
+        instanceElement->build();
+    setNeedsLayout();
+}
+
+SVGElement* SVGUseElement::addInstanceElement()
+{
+    parseAttributesIfNeeded();
     if(auto targetElement = getTargetElement(document())) {
         if(auto newElement = cloneTargetElement(targetElement)) {
+            m_instanceElement = newElement.get();
             addChild(std::move(newElement));
         }
     }
 
-    SVGGraphicsElement::build();
+    return m_instanceElement;
 }
 
 inline bool isDisallowedElement(const SVGElement* element)
@@ -827,13 +1648,21 @@ std::unique_ptr<SVGElement> SVGUseElement::cloneTargetElement(SVGElement* target
         parent = parent->parentElement();
     }
 
+    if(!rootElement()->addUseExpansion(targetElement))
+        return nullptr;
     auto tagId = targetElement->id();
     if(tagId == ElementID::Symbol) {
         tagId = ElementID::Svg;
     }
 
     auto newElement = SVGElement::create(document(), tagId);
-    newElement->setAttributes(targetElement->attributes());
+    if(tagId == targetElement->id()) {
+        targetElement->parseAttributesIfNeeded();
+        targetElement->copyInto(newElement.get());
+    } else {
+        newElement->setAttributes(targetElement->attributes());
+    }
+
     if(newElement->id() == ElementID::Svg) {
         for(const auto& attribute : attributes()) {
             if(attribute.id() == PropertyID::Width || attribute.id() == PropertyID::Height) {
@@ -882,21 +1711,84 @@ Rect SVGImageElement::strokeBoundingBox() const
 
 void SVGImageElement::render(SVGRenderState& state) const
 {
-    if(m_image.isNull() || isDisplayNone() || isVisibilityHidden())
+    if(!hasAttribute(PropertyID::Href) || isDisplayNone() || isVisibilityHidden())
         return;
     Rect dstRect(fillBoundingBox());
-    Rect srcRect(0, 0, m_image.width(), m_image.height());
-    if(dstRect.isEmpty() || srcRect.isEmpty())
+    if(dstRect.isEmpty())
+        return;
+    const auto& image = this->image();
+    Rect srcRect(0, 0, image.width(), image.height());
+    if(srcRect.isEmpty())
         return;
     m_preserveAspectRatio.transformRect(dstRect, srcRect);
 
     SVGBlendInfo blendInfo(this);
     SVGRenderState newState(this, state, localTransform());
     newState.beginGroup(blendInfo);
-    newState->drawImage(m_image, dstRect, srcRect, newState.currentTransform());
+    newState->drawImage(image, dstRect, srcRect, newState.currentTransform());
     newState.endGroup(blendInfo);
 }
 
+class ImageCache {
+public:
+    static ImageCache* instance();
+
+    Bitmap get(std::string_view content);
+
+private:
+    ImageCache() = default;
+    struct Entry {
+        std::string content;
+        Bitmap image;
+        size_t size;
+    };
+
+    using EntryList = std::list<Entry>;
+    std::mutex m_mutex;
+    EntryList m_entries;
+    std::unordered_map<std::string_view, EntryList::iterator> m_lookup;
+    size_t m_totalSize = 0;
+    static constexpr size_t kMaxTotalSize = 64 * 1024 * 1024;
+};
+
+ImageCache* ImageCache::instance()
+{
+    static ImageCache cache;
+    return &cache;
+}
+
+Bitmap ImageCache::get(std::string_view content)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_lookup.find(content);
+        if(it != m_lookup.end()) {
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            return it->second->image;
+        }
+    }
+
+    Bitmap image(plutovg_surface_load_from_image_base64(content.data(), content.length()));
+    if(image.isNull())
+        return image;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_lookup.find(content);
+    if(it != m_lookup.end())
+        return it->second->image;
+    size_t size = content.size() + 4 * static_cast<size_t>(image.width()) * image.height();
+    m_entries.push_front({std::string(content), image, size});
+    m_lookup.emplace(m_entries.front().content, m_entries.begin());
+    m_totalSize += size;
+    while(m_totalSize > kMaxTotalSize && m_entries.size() > 1) {
+        const auto& entry = m_entries.back();
+        m_totalSize -= entry.size;
+        m_lookup.erase(entry.content);
+        m_entries.pop_back();
+    }
+
+    return image;
+}
+
 static Bitmap loadImageResource(const std::string& href)
 {
     if(href.compare(0, 5, "data:") == 0) {
@@ -905,21 +1797,298 @@ static Bitmap loadImageResource(const std::string& href)
         if(index == std::string_view::npos)
             return Bitmap();
         input.remove_prefix(index + 1);
-        return plutovg_surface_load_from_image_base64(input.data(), input.length());
+        return ImageCache::instance()->get(input);
     }
 
     return plutovg_surface_load_from_image_file(href.data());
 }
 
+class ImageHeaderReader {
+public:
+    virtual ~ImageHeaderReader() = default;
+    virtual bool read(uint8_t* data, size_t length) = 0;
+    virtual bool skip(size_t length) = 0;
+};
+
+class Base64HeaderReader final : public ImageHeaderReader {
+public:
+    explicit Base64HeaderReader(std::string_view input) : m_input(input) {}
+
+    bool read(uint8_t* data, size_t length) final;
+    bool skip(size_t length) final;
+
+private:
+    bool readByte(uint8_t& value);
+    std::string_view m_input;
+    uint32_t m_bits = 0;
+    int m_bitCount = 0;
+};
+
+bool Base64HeaderReader::readByte(uint8_t& value)
+{
+    while(m_bitCount < 8) {
+        if(m_input.empty())
+            return false;
+        auto cc = m_input.front();
+        m_input.remove_prefix(1);
+        int digit;
+        if(cc >= 'A' && cc <= 'Z') {
+            digit = cc - 'A';
+        } else if(cc >= 'a' && cc <= 'z') {
+            digit = cc - 'a' + 26;
+        } else if(cc >= '0' && cc <= '9') {
+            digit = cc - '0' + 52;
+        } else if(cc == '+') {
+            digit = 62;
+        } else if(cc == '/') {
+            digit = 63;
+        } else if(IS_WS(cc)) {
+            continue;
+        } else {
+            return false;
+        }
+
+        m_bits = (m_bits << 6) | digit;
+        m_bitCount += 6;
+    }
+
+    m_bitCount -= 8;
+    value = static_cast<uint8_t>(m_bits >> m_bitCount);
+    return true;
+}
+
+bool Base64HeaderReader::read(uint8_t* data, size_t length)
+{
+    for(size_t i = 0; i < length; ++i) {
+        if(!readByte(data[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Base64HeaderReader::skip(size_t length)
+{
+    uint8_t value;
+    for(size_t i = 0; i < length; ++i) {
+        if(!readByte(value)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+class FileHeaderReader final : public ImageHeaderReader {
+public:
+    explicit FileHeaderReader(const char* filename) : m_file(std::fopen(filename, "rb")) {}
+    ~FileHeaderReader() final { if(m_file) std::fclose(m_file); }
+
+    bool read(uint8_t* data, size_t length) final { return m_file && std::fread(data, 1, length, m_file) == length; }
+    bool skip(size_t length) final { return m_file && std::fseek(m_file, static_cast<long>(length), SEEK_CUR) == 0; }
+
+private:
+    std::FILE* m_file;
+};
+
+static uint32_t readBigEndian(const uint8_t* data, int length)
+{
+    uint32_t value = 0;
+    for(int i = 0; i < length; ++i)
+        value = (value << 8) | data[i];
+    return value;
+}
+
+static uint32_t readLittleEndian(const uint8_t* data, int length)
+{
+    uint32_t value = 0;
+    for(int i = length - 1; i >= 0; --i)
+        value = (value << 8) | data[i];
+    return value;
+}
+
+static bool readJpegSize(ImageHeaderReader& reader, int& width, int& height)
+{
+    uint8_t data[5];
+    while(true) {
+        if(!reader.read(data, 1) || data[0] != 0xFF)
+            return false;
+        do {
+            if(!reader.read(data, 1)) {
+                return false;
+            }
+        } while(data[0] == 0xFF);
+
+        const auto marker = data[0];
+        if(marker == 0xD9 || marker == 0xDA)
+            return false;
+        if(marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+            continue;
+        if(!reader.read(data, 2))
+            return false;
+        auto length = readBigEndian(data, 2);
+        if(length < 2)
+            return false;
+        if(marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            if(length < 7 || !reader.read(data, 5))
+                return false;
+            height = readBigEndian(data + 1, 2);
+            width = readBigEndian(data + 3, 2);
+            return true;
+        }
+
+        if(!reader.skip(length - 2)) {
+            return false;
+        }
+    }
+}
+
+static bool readImageSize(ImageHeaderReader& reader, int& width, int& height)
+{
+    uint8_t data[26];
+    if(!reader.read(data, 2))
+        return false;
+    if(data[0] == 0xFF && data[1] == 0xD8) {
+        if(!readJpegSize(reader, width, height)) {
+            return false;
+        }
+    } else if(data[0] == 0x89 && data[1] == 'P') {
+        if(!reader.read(data + 2, 22) || std::memcmp(data + 1, "PNG\r\n\x1A\n", 7) != 0 || std::memcmp(data + 12, "IHDR", 4) != 0)
+            return false;
+        width = readBigEndian(data + 16, 4);
+        height = readBigEndian(data + 20, 4);
+    } else if(data[0] == 'G' && data[1] == 'I') {
+        if(!reader.read(data + 2, 8) || std::memcmp(data, "GIF8", 4) != 0)
+            return false;
+        width = readLittleEndian(data + 6, 2);
+        height = readLittleEndian(data + 8, 2);
+    } else if(data[0] == 'B' && data[1] == 'M') {
+        if(!reader.read(data + 2, 24))
+            return false;
+        if(readLittleEndian(data + 14, 4) == 12) {
+            width = readLittleEndian(data + 18, 2);
+            height = readLittleEndian(data + 20, 2);
+        } else {
+            width = static_cast<int32_t>(readLittleEndian(data + 18, 4));
+            height = std::abs(static_cast<int32_t>(readLittleEndian(data + 22, 4)));
+        }
+    } else {
+        return false;
+    }
+
+    return width > 0 && height > 0;
+}
+
+static void appendBase64(std::string& output, const uint8_t* data, size_t length)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    output.reserve(output.size() + 4 * ((length + 2) / 3));
+    size_t index = 0;
+    for(; index + 2 < length; index += 3) {
+        uint32_t value = data[index] << 16 | data[index + 1] << 8 | data[index + 2];
+        output += table[value >> 18];
+        output += table[(value >> 12) & 0x3F];
+        output += table[(value >> 6) & 0x3F];
+        output += table[value & 0x3F];
+    }
+
+    if(index < length) {
+        uint32_t value = data[index] << 16;
+        if(index + 1 < length)
+            value |= data[index + 1] << 8;
+        output += table[value >> 18];
+        output += table[(value >> 12) & 0x3F];
+        output += index + 1 < length ? table[(value >> 6) & 0x3F] : '=';
+        output += '=';
+    }
+}
+
+bool SVGImageElement::isReleasableAttribute(PropertyID id) const
+{
+    return id == PropertyID::Href;
+}
+
+bool SVGImageElement::canReleaseAttribute(PropertyID id) const
+{
+    if(id == PropertyID::Href)
+        return m_imageLoaded && !m_image.isNull() && getAttribute(PropertyID::Href).compare(0, 5, "data:") == 0;
+    return false;
+}
+
+std::string SVGImageElement::regenerateAttribute(PropertyID id) const
+{
+    if(id != PropertyID::Href || m_image.isNull())
+        return std::string();
+    std::string output("data:image/png;base64,");
+    std::vector<uint8_t> data;
+    m_image.writeToPng([](void* closure, void* data, int size) {
+        auto output = static_cast<std::vector<uint8_t>*>(closure);
+        output->insert(output->end(), static_cast<uint8_t*>(data), static_cast<uint8_t*>(data) + size);
+    }, &data);
+    appendBase64(output, data.data(), data.size());
+    return output;
+}
+
+bool SVGImageElement::probeImageSize(int& width, int& height) const
+{
+    auto attribute = findAttribute(PropertyID::Href);
+    if(attribute == nullptr)
+        return false;
+    const auto& href = attribute->value();
+    if(href.compare(0, 5, "data:") == 0) {
+        std::string_view input(href);
+        auto index = input.find(',', 5);
+        if(index == std::string_view::npos)
+            return false;
+        input.remove_prefix(index + 1);
+        Base64HeaderReader reader(input);
+        return readImageSize(reader, width, height);
+    }
+
+    FileHeaderReader reader(href.data());
+    return readImageSize(reader, width, height);
+}
+
+const Bitmap& SVGImageElement::image() const
+{
+    auto attribute = findAttribute(PropertyID::Href);
+    if(!m_imageLoaded && attribute) {
+        m_imageLoaded = true;
+        auto rootElement = this->rootElement();
+        int width, height;
+        if(rootElement->maxImagePixels() > 0 && probeImageSize(width, height)
+            && static_cast<size_t>(width) * static_cast<size_t>(height) > rootElement->maxImagePixels()) {
+            return m_image;
+        }
+
+        m_image = loadImageResource(attribute->value());
+        if(!m_image.isNull() && !rootElement->addImagePixels(m_image)) {
+            m_image = Bitmap();
+        }
+    }
+
+    return m_image;
+}
+
 void SVGImageElement::parseAttribute(PropertyID id, const std::string& value)
 {
     if(id == PropertyID::Href) {
-        m_image = loadImageResource(value);
+        m_image = Bitmap();
+        m_imageLoaded = false;
     } else {
         SVGGraphicsElement::parseAttribute(id, value);
     }
 }
 
+void SVGImageElement::copyInto(SVGElement* element) const
+{
+    SVGGraphicsElement::copyInto(element);
+    auto imageElement = static_cast<SVGImageElement*>(element);
+    imageElement->m_image = m_image;
+    imageElement->m_imageLoaded = m_imageLoaded;
+}
+
 SVGSymbolElement::SVGSymbolElement(Document* document)
     : SVGGraphicsElement(document, ElementID::Symbol)
     , SVGFitToViewBox(this)
@@ -8,12 +8,90 @@
 #include <forward_list>
 #include <list>
 #include <map>
+#include <mutex>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <cstddef>
 
 namespace lunasvg {
 
 class Document;
 class SVGElement;
 class SVGRootElement;
+class SVGUseElement;
+
+class Arena {
+public:
+    Arena() = default;
+    ~Arena();
+
+    void* allocate(size_t size);
+    void deallocate(void* ptr, size_t size);
+
+private:
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    static constexpr size_t kSizeClassGranularity = alignof(std::max_align_t);
+    static constexpr size_t kMaxSizeClassSize = 1024;
+    static constexpr size_t kSizeClassCount = kMaxSizeClassSize / kSizeClassGranularity;
+
+    struct Block {
+        Block* next;
+    };
+
+    struct FreeEntry {
+        FreeEntry* next;
+    };
+
+    FreeEntry* m_freeLists[kSizeClassCount] = {};
+    Block* m_blocks = nullptr;
+    char* m_ptr = nullptr;
+    char* m_end = nullptr;
+    size_t m_blockSize = 4096;
+};
+
+template<typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator(Arena* arena) : m_arena(arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& allocator) : m_arena(allocator.arena()) {}
+
+    static_assert(alignof(T) <= alignof(std::max_align_t));
+
+    T* allocate(size_t count) { return static_cast<T*>(m_arena->allocate(count * sizeof(T))); }
+    void deallocate(T* ptr, size_t count) { m_arena->deallocate(ptr, count * sizeof(T)); }
+
+    Arena* arena() const { return m_arena; }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& allocator) const { return m_arena == allocator.arena(); }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& allocator) const { return m_arena != allocator.arena(); }
+
+private:
+    Arena* m_arena;
+};
+
+class StringPool {
+public:
+    StringPool() = default;
+
+    const std::string* intern(std::string_view value);
+    void release(const std::string* value);
+
+private:
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    std::deque<std::string> m_strings;
+    std::unordered_map<std::string_view, const std::string*> m_table;
+    std::unordered_map<const std::string*, std::unique_ptr<std::string>> m_releasableStrings;
+};
 
 class SVGNode {
 public:
@@ -21,6 +99,10 @@ public:
         : m_document(document)
     {}
 
+    static void* operator new(size_t size, Document* document);
+    static void operator delete(void* ptr, Document* document);
+    static void operator delete(void* ptr);
+
     virtual ~SVGNode() = default;
     virtual bool isTextNode() const { return false; }
     virtual bool isElement() const { return false; }
@@ -31,6 +113,7 @@ public:
     virtual bool isTextPositioningElement() const { return false; }
 
     Document* document() const { return m_document; }
+    Arena* arena() const { return m_document->m_arena.get(); }
     SVGRootElement* rootElement() const { return m_document->rootElement(); }
 
     SVGElement* parentElement() const { return m_parentElement; }
@@ -39,6 +122,7 @@ public:
     bool isRootElement() const { return m_parentElement == nullptr; }
 
     virtual std::unique_ptr<SVGNode> clone(bool deep) const = 0;
+    virtual std::unique_ptr<SVGNode> cloneInto(Document* document) const = 0;
 
 private:
     SVGNode(const SVGNode&) = delete;
@@ -47,6 +131,12 @@ private:
     SVGElement* m_parentElement = nullptr;
 };
 
+template<typename T, typename... Args>
+inline std::unique_ptr<T> makeSVGNode(Document* document, Args&&... args)
+{
+    return std::unique_ptr<T>(new (document) T(document, std::forward<Args>(args)...));
+}
+
 class SVGTextNode final : public SVGNode {
 public:
     SVGTextNode(Document* document);
@@ -57,6 +147,7 @@ public:
     void setData(const std::string& data);
 
     std::unique_ptr<SVGNode> clone(bool deep) const final;
+    std::unique_ptr<SVGNode> cloneInto(Document* document) const final;
 
 private:
     std::string m_data;
@@ -65,21 +156,59 @@ private:
 class Attribute {
 public:
     Attribute() = default;
-    Attribute(int specificity, PropertyID id, std::string value)
-        : m_specificity(specificity), m_id(id), m_value(std::move(value))
+    Attribute(int specificity, PropertyID id, const std::string* value)
+        : m_specificity(specificity), m_id(id), m_value(value)
     {}
 
+    Attribute(int specificity, PropertyID id, std::string value)
+        : m_specificity(specificity), m_id(id), m_ownedValue(std::make_unique<std::string>(std::move(value)))
+    {
+        m_value = m_ownedValue.get();
+    }
+
+    Attribute(const Attribute& attribute) { *this = attribute; }
+    Attribute(Attribute&&) = default;
+
+    Attribute& operator=(const Attribute& attribute);
+    Attribute& operator=(Attribute&&) = default;
+
     int specificity() const { return m_specificity; }
     PropertyID id() const { return m_id; }
-    const std::string& value() const { return m_value; }
+    const std::string& value() const { return *m_value; }
+
+    bool isParsed() const { return m_parsed; }
+    void setParsed(bool parsed) { m_parsed = parsed; }
+
+    bool isReleased() const { return m_released; }
+    void setReleased(bool released) { m_released = released; }
 
 private:
     int m_specificity;
     PropertyID m_id;
-    std::string m_value;
+    bool m_parsed = false;
+    bool m_released = false;
+    const std::string* m_value;
+    std::unique_ptr<std::string> m_ownedValue;
 };
 
-using AttributeList = std::forward_list<Attribute>;
+inline Attribute& Attribute::operator=(const Attribute& attribute)
+{
+    m_specificity = attribute.m_specificity;
+    m_id = attribute.m_id;
+    m_parsed = attribute.m_parsed;
+    m_released = attribute.m_released;
+    if(attribute.m_ownedValue) {
+        m_ownedValue = std::make_unique<std::string>(*attribute.m_ownedValue);
+        m_value = m_ownedValue.get();
+    } else {
+        m_ownedValue.reset();
+        m_value = attribute.m_value;
+    }
+
+    return *this;
+}
+
+using AttributeList = std::vector<Attribute, ArenaAllocator<Attribute>>;
 
 enum class ElementID : uint8_t {
     Unknown = 0,
@@ -111,8 +240,8 @@ enum class ElementID : uint8_t {
 
 ElementID elementid(std::string_view name);
 
-using SVGNodeList = std::list<std::unique_ptr<SVGNode>>;
-using SVGPropertyList = std::forward_list<SVGProperty*>;
+using SVGNodeList = std::list<std::unique_ptr<SVGNode>, ArenaAllocator<std::unique_ptr<SVGNode>>>;
+using SVGPropertyList = std::forward_list<SVGProperty*, ArenaAllocator<SVGProperty*>>;
 
 class SVGMarkerElement;
 class SVGClipPathElement;
@@ -123,12 +252,54 @@ class SVGRenderState;
 
 extern const std::string emptyString;
 
+struct SVGReference {
+    std::string id;
+    SVGElement* element = nullptr;
+};
+
+class SVGElementIdMap {
+public:
+    SVGElementIdMap() = default;
+
+    bool empty() const { return m_size == 0; }
+
+    SVGElement* find(std::string_view id) const;
+    bool insert(std::string_view id, SVGElement* element);
+    bool erase(std::string_view id);
+
+    template<typename T>
+    void forEach(T callback) const;
+
+private:
+    struct Entry {
+        std::string id;
+        size_t hash = 0;
+        SVGElement* element = nullptr;
+    };
+
+    size_t findSlot(std::string_view id, size_t hash) const;
+    void rehash(size_t capacity);
+
+    std::vector<Entry> m_entries;
+    size_t m_size = 0;
+};
+
+template<typename T>
+inline void SVGElementIdMap::forEach(T callback) const
+{
+    for(const auto& entry : m_entries) {
+        if(entry.element) {
+            callback(entry.id, entry.element);
+        }
+    }
+}
+
 class SVGElement : public SVGNode {
 public:
     static std::unique_ptr<SVGElement> create(Document* document, ElementID id);
 
     SVGElement(Document* document, ElementID id);
-    virtual ~SVGElement() = default;
+    virtual ~SVGElement();
 
     bool hasAttribute(std::string_view name) const;
     const std::string& getAttribute(std::string_view name) const;
@@ -139,14 +310,25 @@ public:
     const std::string& getAttribute(PropertyID id) const;
     bool setAttribute(int specificity, PropertyID id, const std::string& value);
     void setAttributes(const AttributeList& attributes);
-    bool setAttribute(const Attribute& attribute);
+    bool setAttribute(Attribute attribute);
 
     virtual void parseAttribute(PropertyID id, const std::string& value);
+    void parseAttributesIfNeeded();
+
+    virtual bool isReleasableAttribute(PropertyID) const { return false; }
+    virtual bool canReleaseAttribute(PropertyID id) const { return isReleasableAttribute(id); }
+    virtual std::string regenerateAttribute(PropertyID) const { return std::string(); }
+    void releaseAttribute(const std::string* value);
+    void trackReleasableAttribute(const Attribute& attribute);
+    bool hasReleasableAttribute() const;
+    bool isReleaseCandidate() const { return m_releaseCandidate; }
+    void setReleaseCandidate(bool releaseCandidate) { m_releaseCandidate = releaseCandidate; }
 
     SVGElement* previousElement() const;
     SVGElement* nextElement() const;
 
     SVGNode* addChild(std::unique_ptr<SVGNode> child);
+    void removeChild(const SVGNode* child);
     SVGNode* firstChild() const;
     SVGNode* lastChild() const;
 
@@ -160,10 +342,11 @@ public:
     virtual Rect strokeBoundingBox() const;
     virtual Rect paintBoundingBox() const;
 
-    SVGMarkerElement* getMarker(std::string_view id) const;
-    SVGClipPathElement* getClipper(std::string_view id) const;
-    SVGMaskElement* getMasker(std::string_view id) const;
-    SVGPaintElement* getPainter(std::string_view id) const;
+    SVGElement* resolveReference(SVGReference& reference, std::string_view id);
+    SVGMarkerElement* getMarker(SVGReference& reference, std::string_view id);
+    SVGClipPathElement* getClipper(SVGReference& reference, std::string_view id);
+    SVGMaskElement* getMasker(SVGReference& reference, std::string_view id);
+    SVGPaintElement* getPainter(SVGReference& reference, std::string_view id);
 
     SVGElement* elementFromPoint(float x, float y);
 
@@ -177,13 +360,21 @@ public:
 
     void cloneChildren(SVGElement* parentElement) const;
     std::unique_ptr<SVGNode> clone(bool deep) const final;
+    std::unique_ptr<SVGNode> cloneInto(Document* document) const final;
+    virtual void copyInto(SVGElement* element) const;
 
     virtual void build();
 
     virtual void layoutElement(const SVGLayoutState& state);
     void layoutChildren(SVGLayoutState& state);
+    void layoutChildrenInParallel(SVGLayoutState& state, const ParallelExecutor& executor);
     virtual void layout(SVGLayoutState& state);
 
+    bool needsLayout() const { return m_needsLayout; }
+    bool childNeedsLayout() const { return m_childNeedsLayout; }
+    void setNeedsLayout();
+    void updateLayout(SVGLayoutState& state);
+
     void renderChildren(SVGRenderState& state) const;
     virtual void render(SVGRenderState& state) const;
 
@@ -200,10 +391,17 @@ public:
 
     bool isElement() const final { return true; }
 
+protected:
+    void setAttributeParsed(PropertyID id);
+
 private:
+    mutable Rect m_fillBoundingBox = Rect::Invalid;
+    mutable Rect m_strokeBoundingBox = Rect::Invalid;
     mutable Rect m_paintBoundingBox = Rect::Invalid;
     const SVGClipPathElement* m_clipper = nullptr;
     const SVGMaskElement* m_masker = nullptr;
+    SVGReference m_clipperReference;
+    SVGReference m_maskerReference;
     float m_opacity = 1.f;
 
     float m_font_size = 12.f;
@@ -213,7 +411,12 @@ private:
     PointerEvents m_pointer_events = PointerEvents::Auto;
 
     ElementID m_id;
+    bool m_needsAttributeParse = false;
+    bool m_releaseCandidate = false;
+    bool m_needsLayout = true;
+    bool m_childNeedsLayout = false;
     AttributeList m_attributes;
+    mutable std::unique_ptr<std::string> m_regeneratedAttribute;
     SVGPropertyList m_properties;
     SVGNodeList m_children;
 };
@@ -309,7 +512,7 @@ public:
     const SVGTransform& transform() const { return m_transform; }
     Transform localTransform() const override { return m_transform.value(); }
 
-    SVGPaintServer getPaintServer(const Paint& paint, float opacity) const;
+    SVGPaintServer getPaintServer(SVGReference& reference, const Paint& paint, float opacity);
     StrokeData getStrokeData(const SVGLayoutState& state) const;
 
 private:
@@ -338,23 +541,72 @@ private:
 class SVGRootElement final : public SVGSVGElement {
 public:
     SVGRootElement(Document* document);
+    ~SVGRootElement() final;
 
     float intrinsicWidth() const { return m_intrinsicWidth; }
     float intrinsicHeight() const { return m_intrinsicHeight; }
 
-    void setNeedsLayout() { m_intrinsicWidth = -1.f; }
-    bool needsLayout() const { return m_intrinsicWidth == -1.f; }
-
     SVGRootElement* layoutIfNeeded();
+    bool computeIntrinsicSize(float& intrinsicWidth, float& intrinsicHeight) const;
+    void updateIntrinsicSize();
+    std::unique_ptr<SVGRootElement> cloneRoot(Document* document) const;
 
     SVGElement* getElementById(std::string_view id) const;
-    void addElementById(const std::string& id, SVGElement* element);
+    void addElementById(std::string_view id, SVGElement* element);
+    void changeElementId(SVGElement* element, std::string_view oldId, std::string_view newId);
+    void addReferenceDependency(std::string_view id, SVGElement* element, SVGReference* reference);
+    void collectUseElements();
+    void updateUseElements(const SVGElement* element, PropertyID id, std::string_view oldId);
     void layout(SVGLayoutState& state) final;
 
     void forceLayout();
 
+    const std::string* internString(std::string_view value);
+    void setKeepAttributeText(bool keep);
+    void setDeferAttributeParsing(bool defer) { m_deferAttributeParsing = defer; }
+    bool deferAttributeParsing() const { return m_deferAttributeParsing; }
+    void setLayoutExecutor(ParallelExecutor executor) { m_layoutExecutor = std::move(executor); }
+    const ParallelExecutor& layoutExecutor() const { return m_layoutExecutor; }
+    void parseReferenceTargets();
+    void releaseAttributeText();
+    void addReleaseCandidate(SVGElement* element);
+    void removeReleaseCandidate(SVGElement* element) { m_releaseCandidates.erase(element); }
+    void addStyleSheet(std::shared_ptr<const RuleSet> ruleSet) { m_styleSheets.push_back(std::move(ruleSet)); }
+
+    void setMaxUseExpansion(size_t maxUseExpansion) { m_maxUseExpansion = maxUseExpansion; }
+    bool isUseExpansionExceeded() const { return m_maxUseExpansion > 0 && m_useExpansionCount > m_maxUseExpansion; }
+    bool addUseExpansion(const SVGElement* targetElement);
+    void removeUseExpansion(size_t count);
+
+    void setMaxImagePixels(size_t maxImagePixels) { m_maxImagePixels = maxImagePixels; }
+    size_t maxImagePixels() const { return m_maxImagePixels; }
+    bool addImagePixels(const Bitmap& image);
+
 private:
-    std::map<std::string, SVGElement*, std::less<>> m_idCache;
+    void invalidateReferences(std::string_view id);
+    void removeReferenceDependencies(const std::unordered_set<const SVGElement*>& elements);
+
+    struct ReferenceDependency {
+        SVGElement* element;
+        SVGReference* reference;
+    };
+
+    SVGElementIdMap m_idCache;
+    std::unordered_map<std::string, std::vector<ReferenceDependency>> m_referenceDependencies;
+    std::mutex m_referenceDependenciesMutex;
+    std::vector<SVGUseElement*> m_useElements;
+    ParallelExecutor m_layoutExecutor;
+    std::vector<std::shared_ptr<const RuleSet>> m_styleSheets;
+    std::vector<std::shared_ptr<const StringPool>> m_sharedStringPools;
+    std::shared_ptr<StringPool> m_stringPool;
+    std::unordered_set<SVGElement*> m_releaseCandidates;
+    bool m_keepAttributeText = true;
+    bool m_deferAttributeParsing = false;
+    size_t m_maxUseExpansion = 0;
+    size_t m_useExpansionCount = 0;
+    std::unordered_set<const uint8_t*> m_countedImages;
+    size_t m_maxImagePixels = 0;
+    size_t m_imagePixelCount = 0;
     float m_intrinsicWidth{-1.f};
     float m_intrinsicHeight{-1.f};
 };
@@ -368,16 +620,22 @@ public:
     const SVGLength& width() const { return m_width; }
     const SVGLength& height() const { return m_height; }
 
+    SVGElement* instanceElement() const { return m_instanceElement; }
+    void setInstanceElement(SVGElement* element) { m_instanceElement = element; }
+
     Transform localTransform() const final;
     void render(SVGRenderState& state) const final;
     void build() final;
+    void rebuild(std::unordered_set<const SVGElement*>& removedElements);
 
 private:
+    SVGElement* addInstanceElement();
     std::unique_ptr<SVGElement> cloneTargetElement(SVGElement* targetElement);
     SVGLength m_x;
     SVGLength m_y;
     SVGLength m_width;
     SVGLength m_height;
+    SVGElement* m_instanceElement = nullptr;
 };
 
 class SVGImageElement final : public SVGGraphicsElement {
@@ -389,12 +647,17 @@ public:
     const SVGLength& width() const { return m_width; }
     const SVGLength& height() const { return m_height; }
     const SVGPreserveAspectRatio& preserveAspectRatio() const { return m_preserveAspectRatio; }
-    const Bitmap& image() const { return m_image; }
+    const Bitmap& image() const;
+    bool probeImageSize(int& width, int& height) const;
 
     Rect fillBoundingBox() const final;
     Rect strokeBoundingBox() const final;
     void render(SVGRenderState& state) const final;
     void parseAttribute(PropertyID id, const std::string& value) final;
+    bool isReleasableAttribute(PropertyID id) const final;
+    bool canReleaseAttribute(PropertyID id) const final;
+    std::string regenerateAttribute(PropertyID id) const final;
+    void copyInto(SVGElement* element) const final;
 
 private:
     SVGLength m_x;
@@ -402,7 +665,8 @@ private:
     SVGLength m_width;
     SVGLength m_height;
     SVGPreserveAspectRatio m_preserveAspectRatio;
-    Bitmap m_image;
+    mutable Bitmap m_image;
+    mutable bool m_imageLoaded = false;
 };
 
 class SVGSymbolElement final : public SVGGraphicsElement, public SVGFitToViewBox {
@@ -3,6 +3,8 @@
 #include "svgrenderstate.h"
 
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 
 namespace lunasvg {
 
@@ -45,14 +47,14 @@ void SVGGeometryElement::layoutElement(const SVGLayoutState& state)
 {
     m_fill_rule = state.fill_rule();
     m_clip_rule = state.clip_rule();
-    m_fill = getPaintServer(state.fill(), state.fill_opacity());
-    m_stroke = getPaintServer(state.stroke(), state.stroke_opacity());
+    m_fill = getPaintServer(m_fillReference, state.fill(), state.fill_opacity());
+    m_stroke = getPaintServer(m_strokeReference, state.stroke(), state.stroke_opacity());
     m_strokeData = getStrokeData(state);
     SVGGraphicsElement::layoutElement(state);
 
     m_path.reset();
     m_markerPositions.clear();
-    m_fillBoundingBox = updateShape(m_path);
+    m_shapeBoundingBox = updateShape(m_path);
     updateMarkerPositions(m_markerPositions, state);
 }
 
@@ -60,9 +62,9 @@ void SVGGeometryElement::updateMarkerPositions(SVGMarkerPositionList& positions,
 {
     if(m_path.isEmpty())
         return;
-    auto markerStart = getMarker(state.marker_start());
-    auto markerMid = getMarker(state.marker_mid());
-    auto markerEnd = getMarker(state.marker_end());
+    auto markerStart = getMarker(m_markerStartReference, state.marker_start());
+    auto markerMid = getMarker(m_markerMidReference, state.marker_mid());
+    auto markerEnd = getMarker(m_markerEndReference, state.marker_end());
     if(markerStart == nullptr && markerMid == nullptr && markerEnd == nullptr) {
         return;
     }
@@ -315,10 +317,64 @@ SVGPathElement::SVGPathElement(Document* document)
     addProperty(m_d);
 }
 
+void SVGPathElement::setPath(Path path)
+{
+    m_d.setValue(std::move(path));
+    setAttributeParsed(PropertyID::D);
+}
+
 Rect SVGPathElement::updateShape(Path& path)
 {
     path = m_d.value();
     return path.boundingRect();
 }
 
+bool SVGPathElement::isReleasableAttribute(PropertyID id) const
+{
+    return id == PropertyID::D;
+}
+
+static void appendNumber(std::string& output, float value)
+{
+    char buffer[32];
+    for(int precision = 6; precision <= 9; ++precision) {
+        std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+        for(auto& ch : buffer) {
+            if(ch == ',') {
+                ch = '.';
+            }
+        }
+
+        if(std::strtof(buffer, nullptr) == value) {
+            break;
+        }
+    }
+
+    output += buffer;
+}
+
+std::string SVGPathElement::regenerateAttribute(PropertyID id) const
+{
+    std::string output;
+    if(id != PropertyID::D)
+        return output;
+    static const char commands[] = {'M', 'L', 'C', 'Z'};
+    static const int counts[] = {1, 1, 3, 0};
+    std::array<Point, 3> points;
+    for(PathIterator it(m_d.value()); !it.isDone(); it.next()) {
+        auto command = static_cast<int>(it.currentSegment(points));
+        if(!output.empty())
+            output += ' ';
+        output += commands[command];
+        for(int i = 0; i < counts[command]; ++i) {
+            output += ' ';
+            appendNumber(output, points[i].x);
+            output += ' ';
+            appendNumber(output, points[i].y);
+        }
+    }
+
+    return output;
+}
+
 } // namespace lunasvg
@@ -32,7 +32,7 @@ public:
 
     bool isGeometryElement() const final { return true; }
 
-    Rect fillBoundingBox() const override { return m_fillBoundingBox; }
+    Rect fillBoundingBox() const override { return m_shapeBoundingBox; }
     Rect strokeBoundingBox() const override;
     void layoutElement(const SVGLayoutState& state) override;
 
@@ -50,13 +50,19 @@ public:
 
 private:
     Path m_path;
-    Rect m_fillBoundingBox;
+    Rect m_shapeBoundingBox;
     StrokeData m_strokeData;
 
     SVGPaintServer m_fill;
     SVGPaintServer m_stroke;
     SVGMarkerPositionList m_markerPositions;
 
+    SVGReference m_fillReference;
+    SVGReference m_strokeReference;
+    SVGReference m_markerStartReference;
+    SVGReference m_markerMidReference;
+    SVGReference m_markerEndReference;
+
     FillRule m_fill_rule = FillRule::NonZero;
     FillRule m_clip_rule = FillRule::NonZero;
 };
@@ -128,7 +134,12 @@ class SVGPathElement final : public SVGGeometryElement {
 public:
     SVGPathElement(Document* document);
 
+    const SVGPath& d() const { return m_d; }
+    void setPath(Path path);
+
     Rect updateShape(Path& path) final;
+    bool isReleasableAttribute(PropertyID id) const final;
+    std::string regenerateAttribute(PropertyID id) const final;
 
 private:
     SVGPath m_d;
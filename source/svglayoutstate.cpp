@@ -6,10 +6,10 @@
 
 namespace lunasvg {
 
-static std::optional<Color> parseColorValue(std::string_view& input, const SVGLayoutState* state)
+static std::optional<Color> parseColorValue(std::string_view& input, const SVGComputedStyle* style)
 {
     if(skipString(input, "currentColor")) {
-        return state->color();
+        return style->color;
     }
 
     plutovg_color_t color;
@@ -20,22 +20,22 @@ static std::optional<Color> parseColorValue(std::string_view& input, const SVGLa
     return Color(plutovg_color_to_argb32(&color));
 }
 
-static Color parseColor(std::string_view input, const SVGLayoutState* state, const Color& defaultValue)
+static Color parseColor(std::string_view input, const SVGComputedStyle* style, const Color& defaultValue)
 {
-    auto color = parseColorValue(input, state);
+    auto color = parseColorValue(input, style);
     if(!color || !input.empty())
         color = defaultValue;
     return color.value();
 }
 
-static Color parseColorOrNone(std::string_view input, const SVGLayoutState* state, const Color& defaultValue)
+static Color parseColorOrNone(std::string_view input, const SVGComputedStyle* style, const Color& defaultValue)
 {
     if(input.compare("none") == 0)
         return Color::Transparent;
-    return parseColor(input, state, defaultValue);
+    return parseColor(input, style, defaultValue);
 }
 
-static bool parseUrlValue(std::string_view& input, std::string& value)
+static bool parseUrlValue(std::string_view& input, std::string_view& value)
 {
     if(!skipString(input, "url")
         || !skipOptionalSpaces(input)
@@ -52,10 +52,8 @@ static bool parseUrlValue(std::string_view& input, std::string& value)
         skipOptionalSpaces(input);
         if(!skipDelimiter(input, '#'))
             return false;
-        while(!input.empty() && input.front() != delim) {
-            value += input.front();
-            input.remove_prefix(1);
-        }
+        value = input.substr(0, input.find(delim));
+        input.remove_prefix(value.length());
 
         skipOptionalSpaces(input);
         if(!skipDelimiter(input, delim))
@@ -63,10 +61,8 @@ static bool parseUrlValue(std::string_view& input, std::string& value)
         break;
     } case '#': {
         input.remove_prefix(1);
-        while(!input.empty() && input.front() != ')') {
-            value += input.front();
-            input.remove_prefix(1);
-        }
+        value = input.substr(0, input.find(')'));
+        input.remove_prefix(value.length());
 
         break;
     } default:
@@ -76,21 +72,21 @@ static bool parseUrlValue(std::string_view& input, std::string& value)
     return skipOptionalSpaces(input) && skipDelimiter(input, ')');
 }
 
-static std::string parseUrl(std::string_view input)
+static std::string_view parseUrl(std::string_view input)
 {
-    std::string value;
+    std::string_view value;
     if(!parseUrlValue(input, value) || !input.empty())
-        value.clear();
+        return std::string_view();
     return value;
 }
 
-static Paint parsePaint(std::string_view input, const SVGLayoutState* state, const Color& defaultValue)
+static Paint parsePaint(std::string_view input, const SVGComputedStyle* style, const Color& defaultValue)
 {
-    std::string id;
+    std::string_view id;
     if(!parseUrlValue(input, id))
-        return Paint(parseColorOrNone(input, state, defaultValue));
+        return Paint(parseColorOrNone(input, style, defaultValue));
     if(skipOptionalSpaces(input))
-        return Paint(id, parseColorOrNone(input, state, defaultValue));
+        return Paint(id, parseColorOrNone(input, style, defaultValue));
     return Paint(id, Color::Transparent);
 }
 
@@ -129,20 +125,33 @@ static BaselineShift parseBaselineShift(std::string_view input)
     return parseLength(input, LengthNegativeMode::Allow, Length(0.f, LengthUnits::None));
 }
 
-static LengthList parseDashArray(std::string_view input)
+void DashLengthList::push_back(const Length& value)
+{
+    if(m_size < kInlineCapacity) {
+        m_inline[m_size++] = value;
+        return;
+    }
+
+    if(m_size == kInlineCapacity)
+        m_overflow.assign(m_inline.begin(), m_inline.end());
+    m_overflow.push_back(value);
+    ++m_size;
+}
+
+static DashLengthList parseDashArray(std::string_view input)
 {
     if(input.compare("none") == 0)
-        return LengthList();
-    LengthList values;
+        return DashLengthList();
+    DashLengthList values;
     do {
         size_t count = 0;
         while(count < input.length() && input[count] != ',' && !IS_WS(input[count]))
             ++count;
         Length value(0, LengthUnits::None);
         if(!value.parse(input.substr(0, count), LengthNegativeMode::Forbid))
-            return LengthList();
+            return DashLengthList();
         input.remove_prefix(count);
-        values.push_back(std::move(value));
+        values.push_back(value);
     } while(skipOptionalSpacesOrComma(input));
     return values;
 }
@@ -154,15 +163,15 @@ static Length parseLengthOrNormal(std::string_view input)
     return parseLength(input, LengthNegativeMode::Allow, Length(0, LengthUnits::None));
 }
 
-static float parseFontSize(std::string_view input, const SVGLayoutState* state)
+static float parseFontSize(std::string_view input, const SVGComputedStyle* style)
 {
     auto length = parseLength(input, LengthNegativeMode::Forbid, Length(12, LengthUnits::None));
     if(length.units() == LengthUnits::Percent)
-        return length.value() * state->font_size() / 100.f;
+        return length.value() * style->font_size / 100.f;
     if(length.units() == LengthUnits::Ex)
-        return length.value() * state->font_size() / 2.f;
+        return length.value() * style->font_size / 2.f;
     if(length.units() == LengthUnits::Em)
-        return length.value() * state->font_size();
+        return length.value() * style->font_size;
     return length.value();
 }
 
@@ -405,166 +414,186 @@ static LineJoin parseLineJoin(std::string_view input)
     return parseEnumValue(input, entries, LineJoin::Miter);
 }
 
-SVGLayoutState::SVGLayoutState(const SVGLayoutState& parent, const SVGElement* element)
-    : m_parent(&parent)
-    , m_element(element)
-    , m_fill(parent.fill())
-    , m_stroke(parent.stroke())
-    , m_color(parent.color())
-    , m_fill_opacity(parent.fill_opacity())
-    , m_stroke_opacity(parent.stroke_opacity())
-    , m_stroke_miterlimit(parent.stroke_miterlimit())
-    , m_font_size(parent.font_size())
-    , m_letter_spacing(parent.letter_spacing())
-    , m_word_spacing(parent.word_spacing())
-    , m_stroke_width(parent.stroke_width())
-    , m_stroke_dashoffset(parent.stroke_dashoffset())
-    , m_stroke_dasharray(parent.stroke_dasharray())
-    , m_stroke_linecap(parent.stroke_linecap())
-    , m_stroke_linejoin(parent.stroke_linejoin())
-    , m_fill_rule(parent.fill_rule())
-    , m_clip_rule(parent.clip_rule())
-    , m_font_weight(parent.font_weight())
-    , m_font_style(parent.font_style())
-    , m_dominant_baseline(parent.dominant_baseline())
-    , m_text_anchor(parent.text_anchor())
-    , m_white_space(parent.white_space())
-    , m_writing_mode(parent.writing_mode())
-    , m_text_orientation(parent.text_orientation())
-    , m_direction(parent.direction())
-    , m_visibility(parent.visibility())
-    , m_overflow(element->isRootElement() ? Overflow::Visible : Overflow::Hidden)
-    , m_pointer_events(parent.pointer_events())
-    , m_marker_start(parent.marker_start())
-    , m_marker_mid(parent.marker_mid())
-    , m_marker_end(parent.marker_end())
-    , m_font_family(parent.font_family())
+static bool isInheritedProperty(PropertyID id)
+{
+    switch(id) {
+    case PropertyID::Alignment_Baseline:
+    case PropertyID::Baseline_Shift:
+    case PropertyID::Clip_Path:
+    case PropertyID::Display:
+    case PropertyID::Mask:
+    case PropertyID::Mask_Type:
+    case PropertyID::Opacity:
+    case PropertyID::Overflow:
+    case PropertyID::Stop_Color:
+    case PropertyID::Stop_Opacity:
+        return false;
+    default:
+        return true;
+    }
+}
+
+SVGComputedStyle::SVGComputedStyle(const SVGComputedStyle& parent, const SVGElement* element)
+    : fill(parent.fill)
+    , stroke(parent.stroke)
+    , color(parent.color)
+    , fill_opacity(parent.fill_opacity)
+    , stroke_opacity(parent.stroke_opacity)
+    , stroke_miterlimit(parent.stroke_miterlimit)
+    , font_size(parent.font_size)
+    , letter_spacing(parent.letter_spacing)
+    , word_spacing(parent.word_spacing)
+    , stroke_width(parent.stroke_width)
+    , stroke_dashoffset(parent.stroke_dashoffset)
+    , stroke_dasharray(parent.stroke_dasharray)
+    , stroke_linecap(parent.stroke_linecap)
+    , stroke_linejoin(parent.stroke_linejoin)
+    , fill_rule(parent.fill_rule)
+    , clip_rule(parent.clip_rule)
+    , font_weight(parent.font_weight)
+    , font_style(parent.font_style)
+    , dominant_baseline(parent.dominant_baseline)
+    , text_anchor(parent.text_anchor)
+    , white_space(parent.white_space)
+    , writing_mode(parent.writing_mode)
+    , text_orientation(parent.text_orientation)
+    , direction(parent.direction)
+    , visibility(parent.visibility)
+    , overflow(element->isRootElement() ? Overflow::Visible : Overflow::Hidden)
+    , pointer_events(parent.pointer_events)
+    , marker_start(parent.marker_start)
+    , marker_mid(parent.marker_mid)
+    , marker_end(parent.marker_end)
+    , font_family(parent.font_family)
+    , sharedWithPlainChildren(!element->isRootElement())
 {
     for(const auto& attribute : element->attributes()) {
         std::string_view input(attribute.value());
         stripLeadingAndTrailingSpaces(input);
         if(input.empty() || input.compare("inherit") == 0)
             continue;
+        if(!isInheritedProperty(attribute.id()))
+            sharedWithPlainChildren = false;
         switch(attribute.id()) {
         case PropertyID::Fill:
-            m_fill = parsePaint(input, this, Color::Black);
+            fill = parsePaint(input, this, Color::Black);
             break;
         case PropertyID::Stroke:
-            m_stroke = parsePaint(input, this, Color::Transparent);
+            stroke = parsePaint(input, this, Color::Transparent);
             break;
         case PropertyID::Color:
-            m_color = parseColor(input, this, Color::Black);
+            color = parseColor(input, this, Color::Black);
             break;
         case PropertyID::Stop_Color:
-            m_stop_color = parseColor(input, this, Color::Black);
+            stop_color = parseColor(input, this, Color::Black);
             break;
         case PropertyID::Opacity:
-            m_opacity = parseNumberOrPercentage(input, true, 1.f);
+            opacity = parseNumberOrPercentage(input, true, 1.f);
             break;
         case PropertyID::Fill_Opacity:
-            m_fill_opacity = parseNumberOrPercentage(input, true, 1.f);
+            fill_opacity = parseNumberOrPercentage(input, true, 1.f);
             break;
         case PropertyID::Stroke_Opacity:
-            m_stroke_opacity = parseNumberOrPercentage(input, true, 1.f);
+            stroke_opacity = parseNumberOrPercentage(input, true, 1.f);
             break;
         case PropertyID::Stop_Opacity:
-            m_stop_opacity = parseNumberOrPercentage(input, true, 1.f);
+            stop_opacity = parseNumberOrPercentage(input, true, 1.f);
             break;
         case PropertyID::Stroke_Miterlimit:
-            m_stroke_miterlimit = parseNumberOrPercentage(input, false, 4.f);
+            stroke_miterlimit = parseNumberOrPercentage(input, false, 4.f);
             break;
         case PropertyID::Font_Size:
-            m_font_size = parseFontSize(input, this);
+            font_size = parseFontSize(input, this);
             break;
         case PropertyID::Letter_Spacing:
-            m_letter_spacing = parseLengthOrNormal(input);
+            letter_spacing = parseLengthOrNormal(input);
             break;
         case PropertyID::Word_Spacing:
-            m_word_spacing = parseLengthOrNormal(input);
+            word_spacing = parseLengthOrNormal(input);
             break;
         case PropertyID::Baseline_Shift:
-            m_baseline_shift = parseBaselineShift(input);
+            baseline_shift = parseBaselineShift(input);
             break;
         case PropertyID::Stroke_Width:
-            m_stroke_width = parseLength(input, LengthNegativeMode::Forbid, Length(1.f, LengthUnits::None));
+            stroke_width = parseLength(input, LengthNegativeMode::Forbid, Length(1.f, LengthUnits::None));
             break;
         case PropertyID::Stroke_Dashoffset:
-            m_stroke_dashoffset = parseLength(input, LengthNegativeMode::Allow, Length(0.f, LengthUnits::None));
+            stroke_dashoffset = parseLength(input, LengthNegativeMode::Allow, Length(0.f, LengthUnits::None));
             break;
         case PropertyID::Stroke_Dasharray:
-            m_stroke_dasharray = parseDashArray(input);
+            stroke_dasharray = parseDashArray(input);
             break;
         case PropertyID::Stroke_Linecap:
-            m_stroke_linecap = parseLineCap(input);
+            stroke_linecap = parseLineCap(input);
             break;
         case PropertyID::Stroke_Linejoin:
-            m_stroke_linejoin = parseLineJoin(input);
+            stroke_linejoin = parseLineJoin(input);
             break;
         case PropertyID::Fill_Rule:
-            m_fill_rule = parseFillRule(input);
+            fill_rule = parseFillRule(input);
             break;
         case PropertyID::Clip_Rule:
-            m_clip_rule = parseFillRule(input);
+            clip_rule = parseFillRule(input);
             break;
         case PropertyID::Font_Weight:
-            m_font_weight = parseFontWeight(input);
+            font_weight = parseFontWeight(input);
             break;
         case PropertyID::Font_Style:
-            m_font_style = parseFontStyle(input);
+            font_style = parseFontStyle(input);
             break;
         case PropertyID::Alignment_Baseline:
-            m_alignment_baseline = parseAlignmentBaseline(input);
+            alignment_baseline = parseAlignmentBaseline(input);
             break;
         case PropertyID::Dominant_Baseline:
-            m_dominant_baseline = parseDominantBaseline(input);
+            dominant_baseline = parseDominantBaseline(input);
             break;
         case PropertyID::Direction:
-            m_direction = parseDirection(input);
+            direction = parseDirection(input);
             break;
         case PropertyID::Text_Anchor:
-            m_text_anchor = parseTextAnchor(input);
+            text_anchor = parseTextAnchor(input);
             break;
         case PropertyID::White_Space:
-            m_white_space = parseWhiteSpace(input);
+            white_space = parseWhiteSpace(input);
             break;
         case PropertyID::Writing_Mode:
-            m_writing_mode = parseWritingMode(input);
+            writing_mode = parseWritingMode(input);
             break;
         case PropertyID::Text_Orientation:
-            m_text_orientation = parseTextOrientation(input);
+            text_orientation = parseTextOrientation(input);
             break;
         case PropertyID::Display:
-            m_display = parseDisplay(input);
+            display = parseDisplay(input);
             break;
         case PropertyID::Visibility:
-            m_visibility = parseVisibility(input);
+            visibility = parseVisibility(input);
             break;
         case PropertyID::Overflow:
-            m_overflow = parseOverflow(input);
+            overflow = parseOverflow(input);
             break;
         case PropertyID::Pointer_Events:
-            m_pointer_events = parsePointerEvents(input);
+            pointer_events = parsePointerEvents(input);
             break;
         case PropertyID::Mask_Type:
-            m_mask_type = parseMaskType(input);
+            mask_type = parseMaskType(input);
             break;
         case PropertyID::Mask:
-            m_mask = parseUrl(input);
+            mask = parseUrl(input);
             break;
         case PropertyID::Clip_Path:
-            m_clip_path = parseUrl(input);
+            clip_path = parseUrl(input);
             break;
         case PropertyID::Marker_Start:
-            m_marker_start = parseUrl(input);
+            marker_start = parseUrl(input);
             break;
         case PropertyID::Marker_Mid:
-            m_marker_mid = parseUrl(input);
+            marker_mid = parseUrl(input);
             break;
         case PropertyID::Marker_End:
-            m_marker_end = parseUrl(input);
+            marker_end = parseUrl(input);
             break;
         case PropertyID::Font_Family:
-            m_font_family.assign(input);
+            font_family = input;
             break;
         default:
             break;
@@ -572,13 +601,125 @@ SVGLayoutState::SVGLayoutState(const SVGLayoutState& parent, const SVGElement* e
     }
 }
 
+static bool isStyleProperty(PropertyID id)
+{
+    switch(id) {
+    case PropertyID::Alignment_Baseline:
+    case PropertyID::Baseline_Shift:
+    case PropertyID::Clip_Path:
+    case PropertyID::Clip_Rule:
+    case PropertyID::Color:
+    case PropertyID::Direction:
+    case PropertyID::Display:
+    case PropertyID::Dominant_Baseline:
+    case PropertyID::Fill:
+    case PropertyID::Fill_Opacity:
+    case PropertyID::Fill_Rule:
+    case PropertyID::Font_Family:
+    case PropertyID::Font_Size:
+    case PropertyID::Font_Style:
+    case PropertyID::Font_Weight:
+    case PropertyID::Letter_Spacing:
+    case PropertyID::Marker_End:
+    case PropertyID::Marker_Mid:
+    case PropertyID::Marker_Start:
+    case PropertyID::Mask:
+    case PropertyID::Mask_Type:
+    case PropertyID::Opacity:
+    case PropertyID::Overflow:
+    case PropertyID::Pointer_Events:
+    case PropertyID::Stop_Color:
+    case PropertyID::Stop_Opacity:
+    case PropertyID::Stroke:
+    case PropertyID::Stroke_Dasharray:
+    case PropertyID::Stroke_Dashoffset:
+    case PropertyID::Stroke_Linecap:
+    case PropertyID::Stroke_Linejoin:
+    case PropertyID::Stroke_Miterlimit:
+    case PropertyID::Stroke_Opacity:
+    case PropertyID::Stroke_Width:
+    case PropertyID::Text_Anchor:
+    case PropertyID::Text_Orientation:
+    case PropertyID::Visibility:
+    case PropertyID::White_Space:
+    case PropertyID::Word_Spacing:
+    case PropertyID::Writing_Mode:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool hasSameStyleAttributes(const SVGElement* a, const SVGElement* b)
+{
+    if(a->isRootElement() != b->isRootElement())
+        return false;
+    auto it = a->attributes().begin();
+    auto end = a->attributes().end();
+    auto otherIt = b->attributes().begin();
+    auto otherEnd = b->attributes().end();
+    while(true) {
+        while(it != end && !isStyleProperty(it->id()))
+            ++it;
+        while(otherIt != otherEnd && !isStyleProperty(otherIt->id()))
+            ++otherIt;
+        if(it == end || otherIt == otherEnd)
+            return it == end && otherIt == otherEnd;
+        if(it->id() != otherIt->id() || &it->value() != &otherIt->value())
+            return false;
+        ++it;
+        ++otherIt;
+    }
+}
+
+SVGLayoutState::SVGLayoutState()
+{
+    static const auto defaultStyle = std::make_shared<const SVGComputedStyle>();
+    m_style = defaultStyle;
+}
+
+SVGLayoutState::SVGLayoutState(const SVGLayoutState& parent, const SVGElement* element)
+    : m_parent(&parent)
+    , m_element(element)
+    , m_style(parent.computeStyle(element))
+{
+}
+
+static bool hasStyleAttributes(const SVGElement* element)
+{
+    for(const auto& attribute : element->attributes()) {
+        if(isStyleProperty(attribute.id())) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::shared_ptr<const SVGComputedStyle> SVGLayoutState::computeStyle(const SVGElement* element) const
+{
+    if(m_style->sharedWithPlainChildren && !hasStyleAttributes(element))
+        return m_style;
+    for(const auto& sharedStyle : m_sharedStyles) {
+        if(sharedStyle.element && hasSameStyleAttributes(sharedStyle.element, element)) {
+            return sharedStyle.style;
+        }
+    }
+
+    auto style = std::make_shared<const SVGComputedStyle>(*m_style, element);
+    auto& sharedStyle = m_sharedStyles[m_sharedStyleIndex++ % kStyleSharingCacheSize];
+    sharedStyle.element = element;
+    sharedStyle.style = style;
+    return style;
+}
+
 Font SVGLayoutState::font() const
 {
-    auto bold = m_font_weight == FontWeight::Bold;
-    auto italic = m_font_style == FontStyle::Italic;
+    auto bold = m_style->font_weight == FontWeight::Bold;
+    auto italic = m_style->font_style == FontStyle::Italic;
 
     FontFace face;
-    std::string_view input(m_font_family);
+    std::string_view input(m_style->font_family);
     while(!input.empty() && face.isNull()) {
         auto family = input.substr(0, input.find(','));
         input.remove_prefix(family.length());
@@ -601,7 +742,7 @@ Font SVGLayoutState::font() const
 
     if(face.isNull())
         face = fontFaceCache()->getFontFace(emptyString, bold, italic);
-    return Font(face, m_font_size);
+    return Font(face, m_style->font_size);
 }
 
 } // namespace lunasvg
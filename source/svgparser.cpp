@@ -1,8 +1,11 @@
 #include "lunasvg.h"
 #include "svgelement.h"
 #include "svgparserutils.h"
+#include "gzip.h"
 
 #include <cassert>
+#include <climits>
+#include <unordered_set>
 
 namespace lunasvg {
 
@@ -299,6 +302,204 @@ bool RuleData::match(const SVGElement* element) const
     return matchSelector(m_selector, element);
 }
 
+constexpr uint32_t kTagHashSalt = 13;
+constexpr uint32_t kIdHashSalt = 17;
+constexpr uint32_t kClassHashSalt = 19;
+
+inline uint32_t tagHash(ElementID id)
+{
+    auto value = static_cast<char>(id);
+    return hashName(std::string_view(&value, 1), kTagHashSalt);
+}
+
+inline uint32_t idHash(std::string_view value) { return hashName(value, kIdHashSalt); }
+inline uint32_t classHash(std::string_view value) { return hashName(value, kClassHashSalt); }
+
+template<typename T>
+inline void forEachClassName(std::string_view input, T callback)
+{
+    while(skipOptionalSpaces(input)) {
+        size_t length = 0;
+        while(length < input.length() && !IS_WS(input[length]))
+            ++length;
+        callback(input.substr(0, length));
+        input.remove_prefix(length);
+    }
+}
+
+class SelectorFilter {
+public:
+    SelectorFilter() = default;
+
+    void pushParent(const SVGElement* element) { update(element, 1); }
+    void popParent(const SVGElement* element) { update(element, -1); }
+
+    bool mayContain(uint32_t hash) const { return m_counts[hash & kKeyMask] && m_counts[(hash >> kKeyBits) & kKeyMask]; }
+
+private:
+    static constexpr int kKeyBits = 12;
+    static constexpr uint32_t kKeyMask = (1 << kKeyBits) - 1;
+
+    void update(uint32_t hash, int delta)
+    {
+        m_counts[hash & kKeyMask] += delta;
+        m_counts[(hash >> kKeyBits) & kKeyMask] += delta;
+    }
+
+    void update(const SVGElement* element, int delta)
+    {
+        update(tagHash(element->id()), delta);
+        if(auto attribute = element->findAttribute(PropertyID::Id))
+            update(idHash(attribute->value()), delta);
+        if(auto attribute = element->findAttribute(PropertyID::Class)) {
+            forEachClassName(attribute->value(), [&](std::string_view name) { update(classHash(name), delta); });
+        }
+    }
+
+    uint16_t m_counts[1 << kKeyBits] = {};
+};
+
+static void collectAncestorHashes(const SimpleSelector& selector, std::vector<uint32_t>& hashes)
+{
+    if(selector.id != ElementID::Star)
+        hashes.push_back(tagHash(selector.id));
+    for(const auto& attributeSelector : selector.attributeSelectors) {
+        if(attributeSelector.id == PropertyID::Id && attributeSelector.matchType == AttributeSelector::MatchType::Equals) {
+            hashes.push_back(idHash(attributeSelector.value));
+        } else if(attributeSelector.id == PropertyID::Class && attributeSelector.matchType == AttributeSelector::MatchType::Includes) {
+            hashes.push_back(classHash(attributeSelector.value));
+        }
+    }
+}
+
+class RuleSet {
+public:
+    explicit RuleSet(RuleDataList rules);
+
+    bool empty() const { return m_rules.empty(); }
+    void apply(SVGElement* element) const;
+
+private:
+    void apply(SVGElement* element, SelectorFilter& filter, std::vector<uint32_t>& candidates) const;
+    void collectCandidates(const SVGElement* element, std::vector<uint32_t>& candidates) const;
+
+    RuleDataList m_rules;
+    std::vector<std::vector<uint32_t>> m_ancestorHashes;
+    std::unordered_map<std::string_view, std::vector<uint32_t>> m_idRules;
+    std::unordered_map<std::string_view, std::vector<uint32_t>> m_classRules;
+    std::map<ElementID, std::vector<uint32_t>> m_tagRules;
+    std::vector<uint32_t> m_universalRules;
+};
+
+RuleSet::RuleSet(RuleDataList rules)
+    : m_rules(std::move(rules))
+{
+    std::sort(m_rules.begin(), m_rules.end());
+    m_ancestorHashes.resize(m_rules.size());
+    for(uint32_t index = 0; index < m_rules.size(); ++index) {
+        const auto& selector = m_rules[index].selector();
+        if(selector.empty())
+            continue;
+        for(size_t i = selector.size() - 1; i > 0; --i) {
+            auto combinator = selector[i].combinator;
+            if(combinator == SimpleSelector::Combinator::Descendant || combinator == SimpleSelector::Combinator::Child) {
+                collectAncestorHashes(selector[i - 1], m_ancestorHashes[index]);
+            }
+        }
+
+        const auto& subject = selector.back();
+        const AttributeSelector* idSelector = nullptr;
+        const AttributeSelector* classSelector = nullptr;
+        for(const auto& attributeSelector : subject.attributeSelectors) {
+            if(attributeSelector.id == PropertyID::Id && attributeSelector.matchType == AttributeSelector::MatchType::Equals) {
+                idSelector = &attributeSelector;
+                break;
+            }
+
+            if(classSelector == nullptr && attributeSelector.id == PropertyID::Class && attributeSelector.matchType == AttributeSelector::MatchType::Includes) {
+                classSelector = &attributeSelector;
+            }
+        }
+
+        if(idSelector) {
+            m_idRules[idSelector->value].push_back(index);
+        } else if(classSelector) {
+            m_classRules[classSelector->value].push_back(index);
+        } else if(subject.id != ElementID::Star) {
+            m_tagRules[subject.id].push_back(index);
+        } else {
+            m_universalRules.push_back(index);
+        }
+    }
+}
+
+void RuleSet::collectCandidates(const SVGElement* element, std::vector<uint32_t>& candidates) const
+{
+    auto addRules = [&](const std::vector<uint32_t>& rules) {
+        candidates.insert(candidates.end(), rules.begin(), rules.end());
+    };
+
+    if(auto attribute = element->findAttribute(PropertyID::Id)) {
+        auto it = m_idRules.find(attribute->value());
+        if(it != m_idRules.end()) {
+            addRules(it->second);
+        }
+    }
+
+    if(auto attribute = element->findAttribute(PropertyID::Class)) {
+        forEachClassName(attribute->value(), [&](std::string_view name) {
+            auto it = m_classRules.find(name);
+            if(it != m_classRules.end()) {
+                addRules(it->second);
+            }
+        });
+    }
+
+    auto it = m_tagRules.find(element->id());
+    if(it != m_tagRules.end())
+        addRules(it->second);
+    addRules(m_universalRules);
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+}
+
+void RuleSet::apply(SVGElement* element) const
+{
+    SelectorFilter filter;
+    std::vector<uint32_t> candidates;
+    apply(element, filter, candidates);
+}
+
+void RuleSet::apply(SVGElement* element, SelectorFilter& filter, std::vector<uint32_t>& candidates) const
+{
+    candidates.clear();
+    collectCandidates(element, candidates);
+    for(auto index : candidates) {
+        const auto& hashes = m_ancestorHashes[index];
+        auto rejected = std::any_of(hashes.begin(), hashes.end(), [&](auto hash) { return !filter.mayContain(hash); });
+        if(rejected)
+            continue;
+        const auto& rule = m_rules[index];
+        if(rule.match(element)) {
+            for(const auto& declaration : rule.declarations()) {
+                element->setAttribute(Attribute(declaration.specificity, declaration.id, &declaration.value));
+            }
+        }
+    }
+
+    if(element->children().empty())
+        return;
+    filter.pushParent(element);
+    for(const auto& child : element->children()) {
+        if(auto childElement = toSVGElement(child)) {
+            apply(childElement, filter, candidates);
+        }
+    }
+
+    filter.popParent(element);
+}
+
 constexpr bool IS_CSS_STARTNAMECHAR(int c) { return IS_ALPHA(c) || c == '_' || c == '-'; }
 constexpr bool IS_CSS_NAMECHAR(int c) { return IS_CSS_STARTNAMECHAR(c) || IS_NUM(c); }
 
@@ -618,6 +819,11 @@ inline void removeStyleComments(std::string& value)
     auto start = value.find("/*");
     while(start != std::string::npos) {
         auto end = value.find("*/", start + 2);
+        if(end == std::string::npos) {
+            value.erase(start);
+            break;
+        }
+
         value.erase(start, end - start + 2);
         start = value.find("/*");
     }
@@ -627,12 +833,11 @@ inline bool decodeText(std::string_view input, std::string& output)
 {
     output.clear();
     while(!input.empty()) {
-        auto ch = input.front();
-        input.remove_prefix(1);
-        if(ch != '&') {
-            output.push_back(ch);
-            continue;
-        }
+        auto n = input.find('&');
+        output.append(input.substr(0, n));
+        if(n == std::string_view::npos)
+            break;
+        input.remove_prefix(n + 1);
 
         if(skipDelimiter(input, '#')) {
             int base = 10;
@@ -696,242 +901,636 @@ inline bool decodeText(std::string_view input, std::string& output)
 constexpr bool IS_STARTNAMECHAR(int c) { return IS_ALPHA(c) ||  c == '_' || c == ':'; }
 constexpr bool IS_NAMECHAR(int c) { return IS_STARTNAMECHAR(c) || IS_NUM(c) || c == '-' || c == '.'; }
 
+struct NameCharTable {
+    constexpr NameCharTable()
+    {
+        for(int c = 0; c < 256; ++c) {
+            values[c] = IS_NAMECHAR(c);
+        }
+    }
+
+    bool values[256] = {};
+};
+
+constexpr NameCharTable nameCharTable;
+
 inline bool readIdentifier(std::string_view& input, std::string& output)
 {
     if(input.empty() || !IS_STARTNAMECHAR(input.front()))
         return false;
-    output.clear();
-    do {
-        output.push_back(input.front());
-        input.remove_prefix(1);
-    } while(!input.empty() && IS_NAMECHAR(input.front()));
+    auto data = reinterpret_cast<const uint8_t*>(input.data());
+    size_t length = 1;
+    while(length < input.length() && nameCharTable.values[data[length]])
+        ++length;
+    output.assign(input, 0, length);
+    input.remove_prefix(length);
     return true;
 }
 
-bool Document::parse(const char* data, size_t length)
+class SVGParser {
+public:
+    SVGParser(Document* document, const ParseOptions& options)
+        : m_document(document), m_options(options)
+    {}
+
+    bool parse(std::string_view& input, bool final);
+    bool parseRootElement(std::string_view input);
+    bool feed(const char* data, size_t length);
+    bool feedText(const char* data, size_t length);
+    bool finish();
+
+    void setStopAtRootElement(bool stop) { m_stopAtRootElement = stop; }
+
+    ParseError error() const { return m_error; }
+
+private:
+    bool scanToken(std::string_view input, bool final, size_t& length);
+    bool parseToken(std::string_view input);
+    void handleText(std::string_view text, bool in_cdata);
+    bool checkImagePixels() const;
+
+    Document* m_document;
+    ParseOptions m_options;
+    ParseError m_error = ParseError::None;
+    SVGElement* m_currentElement = nullptr;
+    size_t m_dataSize = 0;
+    size_t m_elementCount = 0;
+    size_t m_depth = 0;
+    int m_ignoring = 0;
+    bool m_started = false;
+    bool m_failed = false;
+    bool m_stopAtRootElement = false;
+    size_t m_scanOffset = 0;
+    char m_scanQuote = 0;
+    std::string m_buffer;
+    std::string m_styleSheet;
+    std::string m_pending;
+    std::unique_ptr<GzipDecoder> m_gzipDecoder;
+};
+
+void SVGParser::handleText(std::string_view text, bool in_cdata)
 {
-    std::string buffer;
-    std::string styleSheet;
-    SVGElement* currentElement = nullptr;
-    int ignoring = 0;
-    auto handleText = [&](std::string_view text, bool in_cdata) {
-        if(text.empty() || currentElement == nullptr || ignoring > 0)
-            return;
-        if(currentElement->id() != ElementID::Text && currentElement->id() != ElementID::Tspan && currentElement->id() != ElementID::Style) {
-            return;
+    if(text.empty() || m_currentElement == nullptr || m_ignoring > 0)
+        return;
+    if(m_currentElement->id() != ElementID::Text && m_currentElement->id() != ElementID::Tspan && m_currentElement->id() != ElementID::Style) {
+        return;
+    }
+
+    if(in_cdata) {
+        m_buffer.assign(text);
+    } else {
+        decodeText(text, m_buffer);
+    }
+
+    if(m_currentElement->id() == ElementID::Style) {
+        removeStyleComments(m_buffer);
+        m_styleSheet.append(m_buffer);
+    } else {
+        auto node = makeSVGNode<SVGTextNode>(m_document);
+        node->setData(m_buffer);
+        m_currentElement->addChild(std::move(node));
+    }
+}
+
+bool SVGParser::scanToken(std::string_view input, bool final, size_t& length)
+{
+    auto findDelimiter = [&](std::string_view delimiter, size_t start) {
+        auto offset = std::max(start, m_scanOffset);
+        auto n = input.find(delimiter, offset);
+        if(n == std::string_view::npos) {
+            if(input.length() >= delimiter.length())
+                m_scanOffset = std::max(offset, input.length() - delimiter.length() + 1);
+            length = input.length();
+            return false;
         }
 
-        if(in_cdata) {
-            buffer.assign(text);
-        } else {
-            decodeText(text, buffer);
+        length = n + delimiter.length();
+        return true;
+    };
+
+    if(input.front() != '<') {
+        if(m_currentElement == nullptr) {
+            length = countLeadingSpaces(input);
+            if(length == 0) {
+                length = input.length();
+                return true;
+            }
+
+            return length < input.length() || final;
         }
 
-        if(currentElement->id() == ElementID::Style) {
-            removeStyleComments(buffer);
-            styleSheet.append(buffer);
-        } else {
-            auto node = std::make_unique<SVGTextNode>(this);
-            node->setData(buffer);
-            currentElement->addChild(std::move(node));
+        if(findDelimiter("<", 0)) {
+            --length;
+            return true;
         }
-    };
 
-    std::string_view input(data, length);
-    if(length >= 3) {
-        auto buffer = (const uint8_t*)(data);
+        length = input.length();
+        return final;
+    }
 
-        const auto c1 = buffer[0];
-        const auto c2 = buffer[1];
-        const auto c3 = buffer[2];
-        if(c1 == 0xEF && c2 == 0xBB && c3 == 0xBF) {
-            input.remove_prefix(3);
+    static constexpr std::string_view prefixes[] = {"<?", "<!--", "<![CDATA[", "<!DOCTYPE"};
+    for(auto prefix : prefixes) {
+        if(input.length() < prefix.length() && prefix.substr(0, input.length()) == input) {
+            length = input.length();
+            return final;
         }
     }
 
-    while(!input.empty()) {
-        if(currentElement) {
-            auto text = input.substr(0, input.find('<'));
-            handleText(text, false);
-            input.remove_prefix(text.length());
-        } else {
-            if(!skipOptionalSpaces(input)) {
-                break;
+    if(input.substr(0, 2) == "<?")
+        return findDelimiter("?>", 2) || final;
+    if(input.substr(0, 4) == "<!--")
+        return findDelimiter("-->", 4) || final;
+    if(input.substr(0, 9) == "<![CDATA[")
+        return findDelimiter("]]>", 9) || final;
+    if(input.substr(0, 9) == "<!DOCTYPE") {
+        int depth = 0;
+        for(size_t i = 9; i < input.length(); ++i) {
+            if(input[i] == '[') {
+                ++depth;
+            } else if(input[i] == ']' && depth > 0) {
+                --depth;
+            } else if(input[i] == '>' && depth == 0) {
+                length = i + 1;
+                return true;
             }
         }
 
-        if(!skipDelimiter(input, '<'))
-            return false;
-        if(skipDelimiter(input, '?')) {
-            if(!readIdentifier(input, buffer))
-                return false;
-            auto n = input.find("?>");
+        length = input.length();
+        return final;
+    }
+
+    auto offset = std::max<size_t>(1, m_scanOffset);
+    while(offset < input.length()) {
+        if(m_scanQuote) {
+            auto n = input.find(m_scanQuote, offset);
             if(n == std::string_view::npos)
-                return false;
-            input.remove_prefix(n + 2);
+                break;
+            m_scanQuote = 0;
+            offset = n + 1;
             continue;
         }
 
-        if(skipDelimiter(input, '!')) {
-            if(skipString(input, "--")) {
-                auto n = input.find("-->");
-                if(n == std::string_view::npos)
-                    return false;
-                handleText(input.substr(0, n), false);
-                input.remove_prefix(n + 3);
-                continue;
-            }
+        auto n = findFirstOf(input, '\"', '\'', '>', offset);
+        if(n == std::string_view::npos)
+            break;
+        if(input[n] == '>') {
+            length = n + 1;
+            return true;
+        }
 
-            if(skipString(input, "[CDATA[")) {
-                auto n = input.find("]]>");
-                if(n == std::string_view::npos)
-                    return false;
-                handleText(input.substr(0, n), true);
-                input.remove_prefix(n + 3);
-                continue;
-            }
+        m_scanQuote = input[n];
+        offset = n + 1;
+    }
 
-            if(skipString(input, "DOCTYPE")) {
-                while(!input.empty() && input.front() != '>') {
-                    if(input.front() == '[') {
-                        int depth = 1;
-                        input.remove_prefix(1);
-                        while(!input.empty() && depth > 0) {
-                            if(input.front() == '[') ++depth;
-                            else if(input.front() == ']') --depth;
-                            input.remove_prefix(1);
-                        }
-                    } else {
+    m_scanOffset = input.length();
+    length = input.length();
+    return final;
+}
+
+bool SVGParser::parseToken(std::string_view input)
+{
+    if(m_currentElement) {
+        auto text = input.front() == '<' ? std::string_view() : input;
+        handleText(text, false);
+        input.remove_prefix(text.length());
+    } else {
+        if(!skipOptionalSpaces(input)) {
+            return true;
+        }
+    }
+
+    if(input.empty())
+        return true;
+    if(!skipDelimiter(input, '<'))
+        return false;
+    if(skipDelimiter(input, '?')) {
+        if(!readIdentifier(input, m_buffer))
+            return false;
+        return input.find("?>") != std::string_view::npos;
+    }
+
+    if(skipDelimiter(input, '!')) {
+        if(skipString(input, "--")) {
+            auto n = input.find("-->");
+            if(n == std::string_view::npos)
+                return false;
+            handleText(input.substr(0, n), false);
+            return true;
+        }
+
+        if(skipString(input, "[CDATA[")) {
+            auto n = input.find("]]>");
+            if(n == std::string_view::npos)
+                return false;
+            handleText(input.substr(0, n), true);
+            return true;
+        }
+
+        if(skipString(input, "DOCTYPE")) {
+            while(!input.empty() && input.front() != '>') {
+                if(input.front() == '[') {
+                    int depth = 1;
+                    input.remove_prefix(1);
+                    while(!input.empty() && depth > 0) {
+                        if(input.front() == '[') ++depth;
+                        else if(input.front() == ']') --depth;
                         input.remove_prefix(1);
                     }
+                } else {
+                    input.remove_prefix(1);
                 }
-
-                if(!skipDelimiter(input, '>'))
-                    return false;
-                continue;
             }
 
-            return false;
+            return skipDelimiter(input, '>');
         }
 
-        if(skipDelimiter(input, '/')) {
-            if(currentElement == nullptr && ignoring == 0)
+        return false;
+    }
+
+    if(skipDelimiter(input, '/')) {
+        if(m_currentElement == nullptr && m_ignoring == 0)
+            return false;
+        if(!readIdentifier(input, m_buffer))
+            return false;
+        if(m_ignoring == 0) {
+            auto id = elementid(m_buffer);
+            if(id != m_currentElement->id())
                 return false;
-            if(!readIdentifier(input, buffer))
+            m_currentElement = m_currentElement->parentElement();
+        } else {
+            --m_ignoring;
+        }
+
+        --m_depth;
+        skipOptionalSpaces(input);
+        return skipDelimiter(input, '>');
+    }
+
+    if(!readIdentifier(input, m_buffer))
+        return false;
+    if(m_options.maxElements > 0 && ++m_elementCount > m_options.maxElements) {
+        m_error = ParseError::TooManyElements;
+        return false;
+    }
+
+    if(m_options.maxDepth > 0 && m_depth >= m_options.maxDepth) {
+        m_error = ParseError::TooDeep;
+        return false;
+    }
+
+    auto& rootElement = m_document->m_rootElement;
+    SVGElement* element = nullptr;
+    if(m_ignoring > 0) {
+        ++m_ignoring;
+    } else {
+        auto id = elementid(m_buffer);
+        if(id == ElementID::Unknown) {
+            m_ignoring = 1;
+        } else {
+            if(rootElement && m_currentElement == nullptr)
                 return false;
-            if(ignoring == 0) {
-                auto id = elementid(buffer);
-                if(id != currentElement->id())
+            if(rootElement == nullptr) {
+                if(id != ElementID::Svg)
                     return false;
-                currentElement = currentElement->parentElement();
+                rootElement = makeSVGNode<SVGRootElement>(m_document);
+                rootElement->setDeferAttributeParsing(m_options.deferAttributeParsing);
+                element = rootElement.get();
             } else {
-                --ignoring;
+                auto child = SVGElement::create(m_document, id);
+                element = child.get();
+                m_currentElement->addChild(std::move(child));
             }
-
-            skipOptionalSpaces(input);
-            if(!skipDelimiter(input, '>'))
-                return false;
-            continue;
         }
+    }
 
-        if(!readIdentifier(input, buffer))
+    skipOptionalSpaces(input);
+    while(readIdentifier(input, m_buffer)) {
+        skipOptionalSpaces(input);
+        if(!skipDelimiter(input, '='))
             return false;
-        SVGElement* element = nullptr;
-        if(ignoring > 0) {
-            ++ignoring;
-        } else {
-            auto id = elementid(buffer);
-            if(id == ElementID::Unknown) {
-                ignoring = 1;
+        skipOptionalSpaces(input);
+        if(input.empty() || !(input.front() == '\"' || input.front() == '\''))
+            return false;
+        auto quote = input.front();
+        input.remove_prefix(1);
+        auto n = input.find(quote);
+        if(n == std::string_view::npos)
+            return false;
+        auto id = PropertyID::Unknown;
+        if(element != nullptr)
+            id = propertyid(m_buffer);
+        if(id != PropertyID::Unknown) {
+            decodeText(input.substr(0, n), m_buffer);
+            if(id == PropertyID::Style) {
+                removeStyleComments(m_buffer);
+                parseInlineStyle(m_buffer, element);
             } else {
-                if(m_rootElement && currentElement == nullptr)
-                    return false;
-                if(m_rootElement == nullptr) {
-                    if(id != ElementID::Svg)
-                        return false;
-                    m_rootElement = std::make_unique<SVGRootElement>(this);
-                    element = m_rootElement.get();
-                } else {
-                    auto child = SVGElement::create(this, id);
-                    element = child.get();
-                    currentElement->addChild(std::move(child));
-                }
+                if(id == PropertyID::Id)
+                    rootElement->addElementById(m_buffer, element);
+                element->setAttribute(0x1, id, m_buffer);
             }
         }
 
+        input.remove_prefix(n + 1);
         skipOptionalSpaces(input);
-        while(readIdentifier(input, buffer)) {
-            skipOptionalSpaces(input);
-            if(!skipDelimiter(input, '='))
-                return false;
-            skipOptionalSpaces(input);
-            if(input.empty() || !(input.front() == '\"' || input.front() == '\''))
-                return false;
-            auto quote = input.front();
-            input.remove_prefix(1);
-            auto n = input.find(quote);
-            if(n == std::string_view::npos)
-                return false;
-            auto id = PropertyID::Unknown;
-            if(element != nullptr)
-                id = propertyid(buffer);
-            if(id != PropertyID::Unknown) {
-                decodeText(input.substr(0, n), buffer);
-                if(id == PropertyID::Style) {
-                    removeStyleComments(buffer);
-                    parseInlineStyle(buffer, element);
-                } else {
-                    if(id == PropertyID::Id)
-                        m_rootElement->addElementById(buffer, element);
-                    element->setAttribute(0x1, id, buffer);
-                }
-            }
+    }
 
-            input.remove_prefix(n + 1);
-            skipOptionalSpaces(input);
-        }
+    if(skipDelimiter(input, '>')) {
+        if(element != nullptr)
+            m_currentElement = element;
+        ++m_depth;
+        return true;
+    }
 
-        if(skipDelimiter(input, '>')) {
-            if(element != nullptr)
-                currentElement = element;
-            continue;
+    if(skipDelimiter(input, '/')) {
+        if(!skipDelimiter(input, '>'))
+            return false;
+        if(m_ignoring > 0)
+            --m_ignoring;
+        return true;
+    }
+
+    return false;
+}
+
+static void skipByteOrderMark(std::string_view& input)
+{
+    if(input.length() >= 3) {
+        auto buffer = (const uint8_t*)(input.data());
+
+        const auto c1 = buffer[0];
+        const auto c2 = buffer[1];
+        const auto c3 = buffer[2];
+        if(c1 == 0xEF && c2 == 0xBB && c3 == 0xBF) {
+            input.remove_prefix(3);
         }
+    }
+}
 
-        if(skipDelimiter(input, '/')) {
-            if(!skipDelimiter(input, '>'))
-                return false;
-            if(ignoring > 0)
-                --ignoring;
-            continue;
+bool SVGParser::parse(std::string_view& input, bool final)
+{
+    if(!m_started) {
+        if(input.length() < 3 && !final)
+            return true;
+        skipByteOrderMark(input);
+        m_started = true;
+    }
+
+    while(!input.empty()) {
+        if(m_stopAtRootElement && m_document->m_rootElement)
+            return true;
+        size_t length = 0;
+        if(!scanToken(input, final, length))
+            return true;
+        if(!parseToken(input.substr(0, length)))
+            return false;
+        input.remove_prefix(length);
+        m_scanOffset = 0;
+        m_scanQuote = 0;
+    }
+
+    return true;
+}
+
+bool SVGParser::parseRootElement(std::string_view input)
+{
+    m_stopAtRootElement = true;
+    return parse(input, true) && m_document->m_rootElement != nullptr;
+}
+
+bool SVGParser::feed(const char* data, size_t length)
+{
+    if(m_failed)
+        return false;
+    if(m_dataSize == 0 && m_gzipDecoder == nullptr && length > 0 && static_cast<uint8_t>(data[0]) == 0x1F)
+        m_gzipDecoder = std::make_unique<GzipDecoder>();
+    if(m_gzipDecoder == nullptr)
+        return feedText(data, length);
+    auto success = m_gzipDecoder->decode(data, length, [this](const char* text, size_t size) {
+        return feedText(text, size);
+    });
+
+    if(!success)
+        m_failed = true;
+    return success;
+}
+
+bool SVGParser::feedText(const char* data, size_t length)
+{
+    m_dataSize += length;
+    if(m_options.maxDataSize > 0 && m_dataSize > m_options.maxDataSize) {
+        m_error = ParseError::DataTooLarge;
+        m_failed = true;
+        return false;
+    }
+    if(m_pending.empty()) {
+        std::string_view input(data, length);
+        if(!parse(input, false)) {
+            m_failed = true;
+            return false;
         }
 
+        m_pending.assign(input);
+        return true;
+    }
+
+    m_pending.append(data, length);
+    std::string_view input(m_pending);
+    if(!parse(input, false)) {
+        m_failed = true;
+        return false;
+    }
+
+    m_pending.erase(0, m_pending.length() - input.length());
+    return true;
+}
+
+bool SVGParser::finish()
+{
+    if(m_failed || (m_gzipDecoder && !m_gzipDecoder->isFinished()))
+        return false;
+    std::string_view input(m_pending);
+    if(!parse(input, true))
+        return false;
+    auto& rootElement = m_document->m_rootElement;
+    if(rootElement == nullptr || m_ignoring > 0 || !input.empty())
+        return false;
+    m_document->applyStyleSheet(m_styleSheet);
+    rootElement->setMaxUseExpansion(m_options.maxUseExpansion);
+    rootElement->setMaxImagePixels(m_options.maxImagePixels);
+    rootElement->build();
+    rootElement->collectUseElements();
+    if(rootElement->isUseExpansionExceeded()) {
+        m_error = ParseError::UseExpansionTooLarge;
         return false;
     }
 
-    if(m_rootElement == nullptr || ignoring > 0 || !input.empty())
+    if(m_options.maxImagePixels > 0 && !checkImagePixels()) {
+        m_error = ParseError::ImagesTooLarge;
         return false;
-    applyStyleSheet(styleSheet);
-    m_rootElement->build();
+    }
+
     return true;
 }
 
-void Document::applyStyleSheet(const std::string& content)
+bool SVGParser::checkImagePixels() const
 {
-    auto rules = parseStyleSheet(content);
-    if(!rules.empty()) {
-        std::sort(rules.begin(), rules.end());
-        m_rootElement->transverse([&rules](SVGElement* element) {
-            for(const auto& rule : rules) {
-                if(rule.match(element)) {
-                    for(const auto& declaration : rule.declarations()) {
-                        element->setAttribute(declaration.specificity, declaration.id, declaration.value);
-                    }
-                }
-            }
+    std::unordered_set<std::string_view> images;
+    size_t totalPixels = 0;
+    m_document->m_rootElement->transverse([&](SVGElement* element) {
+        if(element->id() != ElementID::Image)
+            return;
+        auto attribute = element->findAttribute(PropertyID::Href);
+        if(attribute == nullptr || !images.insert(attribute->value()).second)
+            return;
+        int width, height;
+        if(static_cast<SVGImageElement*>(element)->probeImageSize(width, height)) {
+            totalPixels += static_cast<size_t>(width) * static_cast<size_t>(height);
+        }
+    });
+
+    return totalPixels <= m_options.maxImagePixels;
+}
+
+static bool isGzipData(const char* data, size_t length)
+{
+    return length >= 18 && static_cast<uint8_t>(data[0]) == 0x1F && static_cast<uint8_t>(data[1]) == 0x8B && data[2] == 8;
+}
+
+ParseError Document::parse(const char* data, size_t length, const ParseOptions& options)
+{
+    SVGParser parser(this, options);
+    if(isGzipData(data, length)) {
+        if(parser.feed(data, length) && parser.finish())
+            return ParseError::None;
+        if(parser.error() == ParseError::None)
+            return ParseError::InvalidDocument;
+        return parser.error();
+    }
+
+    if(options.maxDataSize > 0 && length > options.maxDataSize)
+        return ParseError::DataTooLarge;
+    std::string_view input(data, length);
+    if(parser.parse(input, true) && parser.finish())
+        return ParseError::None;
+    if(parser.error() == ParseError::None)
+        return ParseError::InvalidDocument;
+    return parser.error();
+}
+
+static bool dependsOnFontSize(const SVGLength& length)
+{
+    return length.value().units() == LengthUnits::Em || length.value().units() == LengthUnits::Ex;
+}
+
+static Box viewBoxOf(const SVGRootElement* rootElement)
+{
+    const auto& viewBoxRect = rootElement->viewBox().value();
+    if(!viewBoxRect.isValid())
+        return Box();
+    return viewBoxRect;
+}
+
+bool Document::probe(const char* data, size_t length, float& width, float& height, Box& viewBox)
+{
+    Document document;
+    if(isGzipData(data, length)) {
+        SVGParser parser(&document, ParseOptions());
+        parser.setStopAtRootElement(true);
+        GzipDecoder decoder;
+        decoder.decode(data, length, [&](const char* text, size_t size) {
+            return parser.feedText(text, size) && document.m_rootElement == nullptr;
         });
+
+        if(document.m_rootElement == nullptr) {
+            return false;
+        }
+    } else {
+        SVGParser parser(&document, ParseOptions());
+        if(!parser.parseRootElement(std::string_view(data, length))) {
+            return false;
+        }
+    }
+
+    auto rootElement = document.m_rootElement.get();
+    rootElement->parseAttributesIfNeeded();
+    if(!dependsOnFontSize(rootElement->width()) && !dependsOnFontSize(rootElement->height())
+        && rootElement->computeIntrinsicSize(width, height)) {
+        viewBox = viewBoxOf(rootElement);
+        return true;
+    }
+
+    auto fullDocument = loadFromData(data, length);
+    if(fullDocument == nullptr)
+        return false;
+    width = fullDocument->width();
+    height = fullDocument->height();
+    viewBox = viewBoxOf(fullDocument->rootElement());
+    return true;
+}
+
+DocumentBuilder::DocumentBuilder()
+    : DocumentBuilder(ParseOptions())
+{
+}
+
+DocumentBuilder::DocumentBuilder(const ParseOptions& options)
+    : m_document(new Document)
+    , m_parser(new SVGParser(m_document.get(), options))
+{
+}
+
+DocumentBuilder::~DocumentBuilder() = default;
+
+bool DocumentBuilder::feed(const char* data, size_t length)
+{
+    if(m_parser == nullptr)
+        return false;
+    if(m_parser->feed(data, length))
+        return true;
+    m_error = m_parser->error() == ParseError::None ? ParseError::InvalidDocument : m_parser->error();
+    return false;
+}
+
+std::unique_ptr<Document> DocumentBuilder::finish()
+{
+    if(m_parser == nullptr)
+        return nullptr;
+    auto success = m_parser->finish();
+    if(!success && m_error == ParseError::None)
+        m_error = m_parser->error() == ParseError::None ? ParseError::InvalidDocument : m_parser->error();
+    m_parser.reset();
+    if(!success)
+        return nullptr;
+    return std::move(m_document);
+}
+
+void Document::applyStyleSheet(const std::string& content)
+{
+    applyStyleSheet(StyleSheet(content));
+}
+
+void Document::applyStyleSheet(const StyleSheet& styleSheet)
+{
+    if(styleSheet.isEmpty())
+        return;
+    styleSheet.m_ruleSet->apply(m_rootElement.get());
+    m_rootElement->addStyleSheet(styleSheet.m_ruleSet);
+}
+
+StyleSheet::StyleSheet(const std::string& content)
+{
+    auto ruleSet = std::make_shared<RuleSet>(parseStyleSheet(content));
+    if(!ruleSet->empty()) {
+        m_ruleSet = std::move(ruleSet);
     }
 }
 
+bool StyleSheet::isEmpty() const
+{
+    return m_ruleSet == nullptr;
+}
+
 ElementList Document::querySelectorAll(const std::string& content) const
 {
     auto selectors = parseQuerySelectors(content);
@@ -4,6 +4,18 @@
 #include <cmath>
 #include <string_view>
 #include <limits>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LUNASVG_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace lunasvg {
 
@@ -38,6 +50,91 @@ constexpr bool skipOptionalSpaces(std::string_view& input)
     return !input.empty();
 }
 
+inline int countTrailingZeros(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+inline size_t findFirstOf(std::string_view input, char a, char b, char c, size_t offset = 0)
+{
+    auto data = input.data();
+    auto length = input.length();
+#if defined(__AVX2__)
+    const auto va = _mm256_set1_epi8(a);
+    const auto vb = _mm256_set1_epi8(b);
+    const auto vc = _mm256_set1_epi8(c);
+    for(; offset + 32 <= length; offset += 32) {
+        auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset));
+        auto matches = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb)), _mm256_cmpeq_epi8(chunk, vc));
+        if(auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(matches))) {
+            return offset + countTrailingZeros(mask);
+        }
+    }
+#elif defined(LUNASVG_SSE2)
+    const auto va = _mm_set1_epi8(a);
+    const auto vb = _mm_set1_epi8(b);
+    const auto vc = _mm_set1_epi8(c);
+    for(; offset + 16 <= length; offset += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+        auto matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)), _mm_cmpeq_epi8(chunk, vc));
+        if(auto mask = static_cast<uint32_t>(_mm_movemask_epi8(matches))) {
+            return offset + countTrailingZeros(mask);
+        }
+    }
+#endif
+    for(; offset < length; ++offset) {
+        auto ch = data[offset];
+        if(ch == a || ch == b || ch == c) {
+            return offset;
+        }
+    }
+
+    return std::string_view::npos;
+}
+
+inline size_t countLeadingSpaces(std::string_view input)
+{
+    auto data = input.data();
+    auto length = input.length();
+    size_t offset = 0;
+#if defined(__AVX2__)
+    const auto space = _mm256_set1_epi8(' ');
+    const auto tab = _mm256_set1_epi8('\t');
+    const auto newline = _mm256_set1_epi8('\n');
+    const auto carriage = _mm256_set1_epi8('\r');
+    for(; offset + 32 <= length; offset += 32) {
+        auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset));
+        auto spaces = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tab)),
+                                      _mm256_or_si256(_mm256_cmpeq_epi8(chunk, newline), _mm256_cmpeq_epi8(chunk, carriage)));
+        if(auto mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(spaces))) {
+            return offset + countTrailingZeros(mask);
+        }
+    }
+#elif defined(LUNASVG_SSE2)
+    const auto space = _mm_set1_epi8(' ');
+    const auto tab = _mm_set1_epi8('\t');
+    const auto newline = _mm_set1_epi8('\n');
+    const auto carriage = _mm_set1_epi8('\r');
+    for(; offset + 16 <= length; offset += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+        auto spaces = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, carriage)));
+        if(auto mask = ~static_cast<uint32_t>(_mm_movemask_epi8(spaces)) & 0xFFFF) {
+            return offset + countTrailingZeros(mask);
+        }
+    }
+#endif
+    while(offset < length && IS_WS(data[offset]))
+        ++offset;
+    return offset;
+}
+
 constexpr bool skipOptionalSpacesOrDelimiter(std::string_view& input, char delimiter)
 {
     if(!input.empty() && !IS_WS(input.front()) && delimiter != input.front())
@@ -88,6 +185,77 @@ constexpr bool skipString(std::string_view& input, std::string_view value)
     return false;
 }
 
+constexpr uint32_t hashName(std::string_view name, uint32_t seed)
+{
+    uint32_t hash = seed ^ 2166136261u;
+    for(auto ch : name) {
+        hash ^= static_cast<uint8_t>(ch);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+template<typename T>
+struct NameEntry {
+    std::string_view name;
+    T value;
+};
+
+template<typename T, size_t N, size_t Size>
+class NameTable {
+public:
+    static_assert(N < 255 && (Size & (Size - 1)) == 0);
+
+    constexpr NameTable(const NameEntry<T> (&entries)[N])
+    {
+        for(size_t i = 0; i < N; ++i)
+            m_entries[i] = entries[i];
+        for(uint32_t seed = 0; seed < 4096; ++seed) {
+            if(build(seed)) {
+                m_seed = seed;
+                return;
+            }
+        }
+    }
+
+    constexpr bool isValid() const { return m_seed != kInvalidSeed; }
+
+    constexpr const NameEntry<T>* find(std::string_view name) const
+    {
+        auto index = m_slots[hashName(name, m_seed) & (Size - 1)];
+        if(index == 0 || m_entries[index - 1].name != name)
+            return nullptr;
+        return &m_entries[index - 1];
+    }
+
+private:
+    constexpr bool build(uint32_t seed)
+    {
+        for(auto& slot : m_slots)
+            slot = 0;
+        for(size_t i = 0; i < N; ++i) {
+            auto& slot = m_slots[hashName(m_entries[i].name, seed) & (Size - 1)];
+            if(slot != 0)
+                return false;
+            slot = static_cast<uint8_t>(i + 1);
+        }
+
+        return true;
+    }
+
+    static constexpr uint32_t kInvalidSeed = ~0u;
+    NameEntry<T> m_entries[N] = {};
+    uint8_t m_slots[Size] = {};
+    uint32_t m_seed = kInvalidSeed;
+};
+
+template<size_t Size, typename T, size_t N>
+constexpr NameTable<T, N, Size> makeNameTable(const NameEntry<T> (&entries)[N])
+{
+    return NameTable<T, N, Size>(entries);
+}
+
 constexpr bool isIntegralDigit(char ch, int base)
 {
     if(IS_NUM(ch))
@@ -141,68 +309,99 @@ inline bool parseInteger(std::string_view& input, T& integer, int base = 10)
     return true;
 }
 
+constexpr double kExactPowersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
 template<typename T>
 inline bool parseNumber(std::string_view& input, T& number)
 {
     constexpr T maxValue = std::numeric_limits<T>::max();
-    T integer = 0;
-    T fraction = 0;
+    constexpr int maxDigits = 19;
+    auto it = input.data();
+    auto end = it + input.size();
+    uint64_t mantissa = 0;
+    int digits = 0;
     int exponent = 0;
-    int sign = 1;
-    int expsign = 1;
+    bool isNegative = false;
 
-    if(!input.empty() && input.front() == '+') {
-        input.remove_prefix(1);
-    } else if(!input.empty() && input.front() == '-') {
-        input.remove_prefix(1);
-        sign = -1;
+    if(it < end && *it == '+') {
+        ++it;
+    } else if(it < end && *it == '-') {
+        ++it;
+        isNegative = true;
     }
 
-    if(input.empty() || (!IS_NUM(input.front()) && input.front() != '.'))
+    if(it == end || (!IS_NUM(*it) && *it != '.'))
         return false;
-    if(IS_NUM(input.front())) {
-        do {
-            integer = static_cast<T>(10) * integer + (input.front() - '0');
-            input.remove_prefix(1);
-        } while(!input.empty() && IS_NUM(input.front()));
+    for(; it < end && IS_NUM(*it); ++it) {
+        if(digits < maxDigits) {
+            mantissa = 10 * mantissa + (*it - '0');
+            digits += mantissa > 0;
+        } else {
+            ++exponent;
+        }
     }
 
-    if(!input.empty() && input.front() == '.') {
-        input.remove_prefix(1);
-        if(input.empty() || !IS_NUM(input.front()))
+    if(it < end && *it == '.') {
+        if(++it == end || !IS_NUM(*it)) {
+            input.remove_prefix(it - input.data());
             return false;
-        T divisor = static_cast<T>(1);
+        }
+
         do {
-            fraction = static_cast<T>(10) * fraction + (input.front() - '0');
-            divisor *= static_cast<T>(10);
-            input.remove_prefix(1);
-        } while(!input.empty() && IS_NUM(input.front()));
-        fraction /= divisor;
+            if(digits < maxDigits) {
+                mantissa = 10 * mantissa + (*it - '0');
+                digits += mantissa > 0;
+                --exponent;
+            }
+        } while(++it < end && IS_NUM(*it));
     }
 
-    if(input.size() > 1 && (input[0] == 'e' || input[0] == 'E')
-        && (input[1] != 'x' && input[1] != 'm'))
+    if(end - it > 1 && (it[0] == 'e' || it[0] == 'E')
+        && (it[1] != 'x' && it[1] != 'm'))
     {
-        input.remove_prefix(1);
-        if(!input.empty() && input.front() == '+')
-            input.remove_prefix(1);
-        else if(!input.empty() && input.front() == '-') {
-            input.remove_prefix(1);
+        ++it;
+        int expsign = 1;
+        if(*it == '+') {
+            ++it;
+        } else if(*it == '-') {
+            ++it;
             expsign = -1;
         }
 
-        if(input.empty() || !IS_NUM(input.front()))
+        if(it == end || !IS_NUM(*it)) {
+            input.remove_prefix(it - input.data());
             return false;
+        }
+
+        int value = 0;
         do {
-            exponent = 10 * exponent + (input.front() - '0');
-            input.remove_prefix(1);
-        } while(!input.empty() && IS_NUM(input.front()));
+            if(value < 100000) {
+                value = 10 * value + (*it - '0');
+            }
+        } while(++it < end && IS_NUM(*it));
+        exponent += expsign * value;
     }
 
-    number = sign * (integer + fraction);
-    if(exponent)
-        number *= static_cast<T>(std::pow(10.0, expsign * exponent));
-    return number >= -maxValue && number <= maxValue;
+    input.remove_prefix(it - input.data());
+
+    // Mantissas up to 2^53 and powers up to 1e22 are exact in a double, so one
+    // rounded multiply or divide gives the correctly rounded result.
+    auto value = static_cast<double>(mantissa);
+    if(exponent == 0 || mantissa == 0) {
+        // already exact
+    } else if(mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+        value = exponent < 0 ? value / kExactPowersOfTen[-exponent] : value * kExactPowersOfTen[exponent];
+    } else {
+        value *= std::pow(10.0, exponent);
+    }
+
+    if(value > static_cast<double>(maxValue))
+        return false;
+    number = static_cast<T>(isNegative ? -value : value);
+    return true;
 }
 
 } // namespace lunasvg
@@ -8,10 +8,7 @@ namespace lunasvg {
 
 PropertyID propertyid(std::string_view name)
 {
-    static const struct {
-        std::string_view name;
-        PropertyID value;
-    } table[] = {
+    static constexpr NameEntry<PropertyID> entries[] = {
         {"class", PropertyID::Class},
         {"clipPathUnits", PropertyID::ClipPathUnits},
         {"cx", PropertyID::Cx},
@@ -61,18 +58,16 @@ PropertyID propertyid(std::string_view name)
         {"y2", PropertyID::Y2}
     };
 
-    auto it = std::lower_bound(table, std::end(table), name, [](const auto& item, const auto& name) { return item.name < name; });
-    if(it == std::end(table) || it->name != name)
-        return csspropertyid(name);
-    return it->value;
+    static constexpr auto table = makeNameTable<512>(entries);
+    static_assert(table.isValid());
+    if(auto entry = table.find(name))
+        return entry->value;
+    return csspropertyid(name);
 }
 
 PropertyID csspropertyid(std::string_view name)
 {
-    static const struct {
-        std::string_view name;
-        PropertyID value;
-    } table[] = {
+    static constexpr NameEntry<PropertyID> entries[] = {
         {"alignment-baseline", PropertyID::Alignment_Baseline},
         {"baseline-shift", PropertyID::Baseline_Shift},
         {"clip-path", PropertyID::Clip_Path},
@@ -115,10 +110,11 @@ PropertyID csspropertyid(std::string_view name)
         {"writing-mode", PropertyID::Writing_Mode}
     };
 
-    auto it = std::lower_bound(table, std::end(table), name, [](const auto& item, const auto& name) { return item.name < name; });
-    if(it == std::end(table) || it->name != name)
-        return PropertyID::Unknown;
-    return it->value;
+    static constexpr auto table = makeNameTable<512>(entries);
+    static_assert(table.isValid());
+    if(auto entry = table.find(name))
+        return entry->value;
+    return PropertyID::Unknown;
 }
 
 SVGProperty::SVGProperty(PropertyID id)
@@ -108,6 +108,7 @@ public:
     PropertyID id() const { return m_id; }
 
     virtual bool parse(std::string_view input) = 0;
+    virtual void copyFrom(const SVGProperty& property) = 0;
 
 private:
     SVGProperty(const SVGProperty&) = delete;
@@ -123,6 +124,7 @@ public:
 
     const std::string& value() const { return m_value; }
     bool parse(std::string_view input) final;
+    void copyFrom(const SVGProperty& property) final { m_value = static_cast<const SVGString&>(property).m_value; }
 
 private:
     std::string m_value;
@@ -132,16 +134,16 @@ class Paint {
 public:
     Paint() = default;
     explicit Paint(const Color& color) : m_color(color) {}
-    Paint(const std::string& id, const Color& color)
+    Paint(std::string_view id, const Color& color)
         : m_id(id), m_color(color)
     {}
 
     const Color& color() const { return m_color; }
-    const std::string& id() const { return m_id; }
+    std::string_view id() const { return m_id; }
     bool isNone() const { return m_id.empty() && !m_color.isVisible(); }
 
 private:
-    std::string m_id;
+    std::string_view m_id;
     Color m_color = Color::Transparent;
 };
 
@@ -274,6 +276,7 @@ public:
 
     Enum value() const { return m_value; }
     bool parse(std::string_view input) final;
+    void copyFrom(const SVGProperty& property) final { m_value = static_cast<const SVGEnumeration<Enum>&>(property).m_value; }
 
 private:
     template<unsigned int N>
@@ -296,6 +299,12 @@ public:
     float value() const { return m_value; }
     OrientType orientType() const { return m_orientType; }
     bool parse(std::string_view input) final;
+    void copyFrom(const SVGProperty& property) final
+    {
+        const auto& other = static_cast<const SVGAngle&>(property);
+        m_value = other.m_value;
+        m_orientType = other.m_orientType;
+    }
 
 private:
     float m_value = 0;
@@ -353,6 +362,7 @@ public:
     LengthNegativeMode negativeMode() const { return m_negativeMode; }
     const Length& value() const { return m_value; }
     bool parse(std::string_view input) final;
+    void copyFrom(const SVGProperty& property) final { m_value = static_cast<const SVGLength&>(property).m_value; }
 
 private:
     const LengthDirection m_direction;
@@ -389,6 +399,7 @@ public:
     LengthNegativeMode negativeMode() const { return m_negativeMode; }
     const LengthList& values() const { return m_values; }
     bool parse(std::string_view input) final;
+    void copyFrom(const SVGProperty& property) final { m_values = static_cast<const SVGLengthList&>(property).m_values; }
 
 private:
     const LengthDirection m_direction;
@@ -426,6 +437,7 @@ public:
 
     float value() const { return m_value; }
     bool parse(std::string_view input) override;
+    void copyFrom(const SVGProperty& property) override { m_value = static_cast<const SVGNumber&>(property).m_value; }
 
 private:
     float m_value;
@@ -440,6 +452,7 @@ public:
 
     float value() const { return m_value; }
     bool parse(std::string_view input) final;
+    void copyFrom(const SVGProperty& property) final { m_value = static_cast<const SVGNumberPercentage&>(property).m_value; }
 
 private:
     float m_value;
@@ -455,6 +468,7 @@ public:
 
     const NumberList& values() const { return m_values; }
     bool parse(std::string_view input) final;
+    void copyFrom(const SVGProperty& property) final { m_values = static_cast<const SVGNumberList&>(property).m_values; }
 
 private:
     NumberList m_values;
@@ -467,7 +481,9 @@ public:
     {}
 
     const Path& value() const { return m_value; }
+    void setValue(Path value) { m_value = std::move(value); }
     bool parse(std::string_view input) final;
+    void copyFrom(const SVGProperty& property) final { m_value = static_cast<const SVGPath&>(property).m_value; }
 
 private:
     Path m_value;
@@ -481,6 +497,7 @@ public:
 
     const Point& value() const { return m_value; }
     bool parse(std::string_view input) final;
+    void copyFrom(const SVGProperty& property) final { m_value = static_cast<const SVGPoint&>(property).m_value; }
 
 private:
     Point m_value;
@@ -496,6 +513,7 @@ public:
 
     const PointList& values() const { return m_values; }
     bool parse(std::string_view input) final;
+    void copyFrom(const SVGProperty& property) final { m_values = static_cast<const SVGPointList&>(property).m_values; }
 
 private:
     PointList m_values;
@@ -510,6 +528,7 @@ public:
 
     const Rect& value() const { return m_value; }
     bool parse(std::string_view input) final;
+    void copyFrom(const SVGProperty& property) final { m_value = static_cast<const SVGRect&>(property).m_value; }
 
 private:
     Rect m_value;
@@ -523,6 +542,7 @@ public:
 
     const Transform& value() const { return m_value; }
     bool parse(std::string_view input) final;
+    void copyFrom(const SVGProperty& property) final { m_value = static_cast<const SVGTransform&>(property).m_value; }
 
 private:
     Transform m_value;
@@ -555,6 +575,12 @@ public:
     AlignType alignType() const { return m_alignType; }
     MeetOrSlice meetOrSlice() const { return m_meetOrSlice; }
     bool parse(std::string_view input) final;
+    void copyFrom(const SVGProperty& property) final
+    {
+        const auto& other = static_cast<const SVGPreserveAspectRatio&>(property);
+        m_alignType = other.m_alignType;
+        m_meetOrSlice = other.m_meetOrSlice;
+    }
 
     Rect getClipRect(const Rect& viewBoxRect, const Size& viewportSize) const;
     Transform getTransform(const Rect& viewBoxRect, const Size& viewportSize) const;
@@ -0,0 +1,431 @@
+#include "lunasvg.h"
+#include "svgelement.h"
+#include "svggeometryelement.h"
+
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+
+namespace lunasvg {
+
+constexpr uint32_t kSnapshotMagic = 0x4753564C;
+constexpr uint32_t kSnapshotVersion = 2;
+
+constexpr uint32_t kTextNodeTag = 0xFF;
+constexpr uint32_t kHasPathFlag = 0x100;
+constexpr uint32_t kUseInstanceFlag = 0x200;
+
+struct SnapshotHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t stringCount;
+    uint32_t stringDataSize;
+    uint32_t idCount;
+    uint32_t nodeCount;
+    uint32_t nodeDataSize;
+};
+
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const SVGRootElement* rootElement);
+
+    std::vector<uint8_t> finish();
+
+private:
+    uint32_t addString(const std::string& value);
+    void writeNode(const SVGNode* node);
+    void writePath(const Path& path);
+    void write(uint32_t value) { m_nodeData.push_back(value); }
+
+    std::vector<uint32_t> m_stringOffsets;
+    std::string m_stringData;
+    std::unordered_map<std::string_view, uint32_t> m_stringTable;
+    std::deque<std::string> m_regeneratedStrings;
+    const SVGRootElement* m_rootElement;
+    std::vector<uint32_t> m_idData;
+    std::vector<uint32_t> m_nodeData;
+    uint32_t m_nodeCount = 0;
+    uint32_t m_elementCount = 0;
+};
+
+SnapshotWriter::SnapshotWriter(const SVGRootElement* rootElement)
+    : m_rootElement(rootElement)
+{
+    writeNode(rootElement);
+}
+
+uint32_t SnapshotWriter::addString(const std::string& value)
+{
+    auto it = m_stringTable.find(value);
+    if(it != m_stringTable.end())
+        return it->second;
+    uint32_t index = m_stringOffsets.size();
+    m_stringOffsets.push_back(m_stringData.size());
+    m_stringData.append(value);
+    m_stringTable.emplace(value, index);
+    return index;
+}
+
+void SnapshotWriter::writeNode(const SVGNode* node)
+{
+    ++m_nodeCount;
+    if(node->isTextNode()) {
+        write(kTextNodeTag);
+        write(addString(static_cast<const SVGTextNode*>(node)->data()));
+        return;
+    }
+
+    auto element = static_cast<const SVGElement*>(node);
+    auto elementIndex = m_elementCount++;
+    if(auto attribute = element->findAttribute(PropertyID::Id)) {
+        if(m_rootElement->getElementById(attribute->value()) == element) {
+            m_idData.push_back(addString(attribute->value()));
+            m_idData.push_back(elementIndex);
+        }
+    }
+
+    Path parsedPath;
+    const Path* path = nullptr;
+    if(element->id() == ElementID::Path) {
+        if(auto attribute = element->findAttribute(PropertyID::D)) {
+            if(attribute->isParsed()) {
+                path = &static_cast<const SVGPathElement*>(element)->d().value();
+            } else {
+                parsedPath.parse(attribute->value().data(), attribute->value().length());
+                path = &parsedPath;
+            }
+        }
+    }
+
+    uint32_t tag = static_cast<uint32_t>(element->id());
+    if(path)
+        tag |= kHasPathFlag;
+    auto parentElement = element->parentElement();
+    if(parentElement && parentElement->id() == ElementID::Use && static_cast<const SVGUseElement*>(parentElement)->instanceElement() == element)
+        tag |= kUseInstanceFlag;
+    write(tag);
+    write(element->attributes().size());
+    write(std::distance(element->children().begin(), element->children().end()));
+    for(const auto& attribute : element->attributes()) {
+        write(static_cast<uint32_t>(attribute.specificity()));
+        write(static_cast<uint32_t>(attribute.id()));
+        if(attribute.isReleased()) {
+            write(addString(m_regeneratedStrings.emplace_back(element->regenerateAttribute(attribute.id()))));
+        } else {
+            write(addString(attribute.value()));
+        }
+    }
+
+    if(path)
+        writePath(*path);
+    for(const auto& child : element->children()) {
+        writeNode(child.get());
+    }
+}
+
+void SnapshotWriter::writePath(const Path& path)
+{
+    std::vector<uint8_t> commands;
+    std::vector<float> coordinates;
+    if(!path.isNull()) {
+        std::array<Point, 3> points;
+        for(PathIterator it(path); !it.isDone(); it.next()) {
+            auto command = it.currentSegment(points);
+            commands.push_back(static_cast<uint8_t>(command));
+            int count = command == PathCommand::CubicTo ? 3 : command == PathCommand::Close ? 0 : 1;
+            for(int i = 0; i < count; ++i) {
+                coordinates.push_back(points[i].x);
+                coordinates.push_back(points[i].y);
+            }
+        }
+    }
+
+    write(commands.size());
+    commands.resize((commands.size() + 3) & ~size_t(3));
+    for(size_t i = 0; i < commands.size(); i += 4) {
+        uint32_t word;
+        std::memcpy(&word, &commands[i], 4);
+        write(word);
+    }
+
+    for(auto coordinate : coordinates) {
+        uint32_t word;
+        std::memcpy(&word, &coordinate, 4);
+        write(word);
+    }
+}
+
+std::vector<uint8_t> SnapshotWriter::finish()
+{
+    m_stringOffsets.push_back(m_stringData.size());
+    m_stringData.resize((m_stringData.size() + 3) & ~size_t(3));
+
+    SnapshotHeader header;
+    header.magic = kSnapshotMagic;
+    header.version = kSnapshotVersion;
+    header.stringCount = m_stringOffsets.size() - 1;
+    header.stringDataSize = m_stringData.size();
+    header.idCount = m_idData.size() / 2;
+    header.nodeCount = m_nodeCount;
+    header.nodeDataSize = m_nodeData.size();
+
+    const size_t offsetsSize = m_stringOffsets.size() * sizeof(uint32_t);
+    const size_t idsSize = m_idData.size() * sizeof(uint32_t);
+    const size_t nodesSize = m_nodeData.size() * sizeof(uint32_t);
+
+    std::vector<uint8_t> snapshot(sizeof(header) + offsetsSize + m_stringData.size() + idsSize + nodesSize);
+    auto data = snapshot.data();
+    std::memcpy(data, &header, sizeof(header));
+    data += sizeof(header);
+    std::memcpy(data, m_stringOffsets.data(), offsetsSize);
+    data += offsetsSize;
+    std::memcpy(data, m_stringData.data(), m_stringData.size());
+    data += m_stringData.size();
+    std::memcpy(data, m_idData.data(), idsSize);
+    data += idsSize;
+    std::memcpy(data, m_nodeData.data(), nodesSize);
+    return snapshot;
+}
+
+class SnapshotReader {
+public:
+    SnapshotReader(const uint8_t* data, size_t length)
+        : m_data(data), m_end(data + length)
+    {}
+
+    bool read(uint32_t& value);
+    bool read(float& value);
+    bool skip(size_t length, const uint8_t*& data);
+
+    size_t remaining() const { return m_end - m_data; }
+
+private:
+    const uint8_t* m_data;
+    const uint8_t* m_end;
+};
+
+bool SnapshotReader::read(uint32_t& value)
+{
+    if(remaining() < sizeof(value))
+        return false;
+    std::memcpy(&value, m_data, sizeof(value));
+    m_data += sizeof(value);
+    return true;
+}
+
+bool SnapshotReader::read(float& value)
+{
+    if(remaining() < sizeof(value))
+        return false;
+    std::memcpy(&value, m_data, sizeof(value));
+    m_data += sizeof(value);
+    return true;
+}
+
+bool SnapshotReader::skip(size_t length, const uint8_t*& data)
+{
+    if(remaining() < length)
+        return false;
+    data = m_data;
+    m_data += length;
+    return true;
+}
+
+static bool readCoordinates(SnapshotReader& reader, float* coordinates, int count)
+{
+    for(int i = 0; i < count; ++i) {
+        if(!reader.read(coordinates[i]) || !std::isfinite(coordinates[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool readPath(SnapshotReader& reader, Path& path)
+{
+    uint32_t commandCount;
+    const uint8_t* commands;
+    if(!reader.read(commandCount) || !reader.skip((size_t(commandCount) + 3) & ~size_t(3), commands))
+        return false;
+    float coordinates[6];
+    for(uint32_t i = 0; i < commandCount; ++i) {
+        auto command = static_cast<PathCommand>(commands[i]);
+        switch(command) {
+        case PathCommand::MoveTo:
+            if(!readCoordinates(reader, coordinates, 2))
+                return false;
+            path.moveTo(coordinates[0], coordinates[1]);
+            break;
+        case PathCommand::LineTo:
+            if(!readCoordinates(reader, coordinates, 2))
+                return false;
+            path.lineTo(coordinates[0], coordinates[1]);
+            break;
+        case PathCommand::CubicTo:
+            if(!readCoordinates(reader, coordinates, 6))
+                return false;
+            path.cubicTo(coordinates[0], coordinates[1], coordinates[2], coordinates[3], coordinates[4], coordinates[5]);
+            break;
+        case PathCommand::Close:
+            path.close();
+            break;
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool isValidElementTag(uint32_t tag)
+{
+    return tag >= static_cast<uint32_t>(ElementID::Circle) && tag <= static_cast<uint32_t>(ElementID::Use);
+}
+
+static bool isValidPropertyId(uint32_t id)
+{
+    return id > static_cast<uint32_t>(PropertyID::Unknown) && id <= static_cast<uint32_t>(PropertyID::Y2);
+}
+
+std::vector<uint8_t> Document::serialize() const
+{
+    SnapshotWriter writer(m_rootElement.get());
+    return writer.finish();
+}
+
+std::unique_ptr<Document> Document::loadFromSnapshot(const void* data, size_t length)
+{
+    SnapshotReader reader(static_cast<const uint8_t*>(data), length);
+    SnapshotHeader header;
+    const uint8_t* headerData;
+    if(!reader.skip(sizeof(header), headerData))
+        return nullptr;
+    std::memcpy(&header, headerData, sizeof(header));
+    if(header.magic != kSnapshotMagic || header.version != kSnapshotVersion || header.nodeCount == 0)
+        return nullptr;
+    const uint8_t* offsetData;
+    const uint8_t* stringData;
+    if(!reader.skip((size_t(header.stringCount) + 1) * sizeof(uint32_t), offsetData)
+        || !reader.skip(header.stringDataSize, stringData)) {
+        return nullptr;
+    }
+
+    std::vector<std::string_view> strings;
+    strings.reserve(header.stringCount);
+    for(uint32_t i = 0; i < header.stringCount; ++i) {
+        uint32_t offsets[2];
+        std::memcpy(offsets, offsetData + i * sizeof(uint32_t), sizeof(offsets));
+        if(offsets[0] > offsets[1] || offsets[1] > header.stringDataSize)
+            return nullptr;
+        strings.emplace_back(reinterpret_cast<const char*>(stringData + offsets[0]), offsets[1] - offsets[0]);
+    }
+
+    const uint8_t* idData;
+    if(!reader.skip(size_t(header.idCount) * 2 * sizeof(uint32_t), idData)
+        || reader.remaining() != size_t(header.nodeDataSize) * sizeof(uint32_t)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Document> document(new Document);
+    std::vector<const std::string*> values(header.stringCount, nullptr);
+    std::vector<SVGElement*> elements;
+    struct Entry {
+        SVGElement* element;
+        uint32_t remaining;
+    };
+
+    std::vector<Entry> stack;
+    for(uint32_t nodeIndex = 0; nodeIndex < header.nodeCount; ++nodeIndex) {
+        while(!stack.empty() && stack.back().remaining == 0)
+            stack.pop_back();
+        if(nodeIndex > 0 && stack.empty())
+            return nullptr;
+        uint32_t tag;
+        if(!reader.read(tag))
+            return nullptr;
+        if(tag == kTextNodeTag) {
+            uint32_t index;
+            if(nodeIndex == 0 || !reader.read(index) || index >= header.stringCount)
+                return nullptr;
+            auto node = makeSVGNode<SVGTextNode>(document.get());
+            node->setData(std::string(strings[index]));
+            stack.back().element->addChild(std::move(node));
+            stack.back().remaining -= 1;
+            continue;
+        }
+
+        auto elementId = tag & ~(kHasPathFlag | kUseInstanceFlag);
+        if(!isValidElementTag(elementId))
+            return nullptr;
+        SVGElement* element = nullptr;
+        if(nodeIndex == 0) {
+            if(elementId != static_cast<uint32_t>(ElementID::Svg))
+                return nullptr;
+            document->m_rootElement = makeSVGNode<SVGRootElement>(document.get());
+            element = document->m_rootElement.get();
+        } else {
+            auto child = SVGElement::create(document.get(), static_cast<ElementID>(elementId));
+            element = child.get();
+            auto parentElement = stack.back().element;
+            if(tag & kUseInstanceFlag) {
+                if(parentElement->id() != ElementID::Use)
+                    return nullptr;
+                static_cast<SVGUseElement*>(parentElement)->setInstanceElement(element);
+            }
+
+            parentElement->addChild(std::move(child));
+            stack.back().remaining -= 1;
+        }
+
+        uint32_t attributeCount;
+        uint32_t childCount;
+        if(!reader.read(attributeCount) || !reader.read(childCount))
+            return nullptr;
+        auto rootElement = document->m_rootElement.get();
+        for(uint32_t i = 0; i < attributeCount; ++i) {
+            uint32_t specificity, id, index;
+            if(!reader.read(specificity) || !reader.read(id) || !reader.read(index))
+                return nullptr;
+            if(!isValidPropertyId(id) || index >= header.stringCount)
+                return nullptr;
+            auto& value = values[index];
+            if(value == nullptr)
+                value = rootElement->internString(strings[index]);
+            element->setAttribute(Attribute(specificity, static_cast<PropertyID>(id), value));
+        }
+
+        if(tag & kHasPathFlag) {
+            Path path;
+            if(elementId != static_cast<uint32_t>(ElementID::Path) || !readPath(reader, path))
+                return nullptr;
+            static_cast<SVGPathElement*>(element)->setPath(std::move(path));
+        }
+
+        elements.push_back(element);
+        stack.push_back({element, childCount});
+    }
+
+    for(const auto& entry : stack) {
+        if(entry.remaining > 0) {
+            return nullptr;
+        }
+    }
+
+    if(reader.remaining() > 0)
+        return nullptr;
+    for(uint32_t i = 0; i < header.idCount; ++i) {
+        uint32_t entry[2];
+        std::memcpy(entry, idData + i * sizeof(entry), sizeof(entry));
+        if(entry[0] >= header.stringCount || entry[1] >= elements.size())
+            return nullptr;
+        document->m_rootElement->addElementById(std::string(strings[entry[0]]), elements[entry[1]]);
+    }
+
+    document->m_rootElement->collectUseElements();
+
+    return document;
+}
+
+} // namespace lunasvg
@@ -456,8 +456,8 @@ SVGTextContentElement::SVGTextContentElement(Document* document, ElementID id)
 void SVGTextContentElement::layoutElement(const SVGLayoutState& state)
 {
     m_font = state.font();
-    m_fill = getPaintServer(state.fill(), state.fill_opacity());
-    m_stroke = getPaintServer(state.stroke(), state.stroke_opacity());
+    m_fill = getPaintServer(m_fillReference, state.fill(), state.fill_opacity());
+    m_stroke = getPaintServer(m_strokeReference, state.stroke(), state.stroke_opacity());
     SVGGraphicsElement::layoutElement(state);
 
     LengthContext lengthContext(this);
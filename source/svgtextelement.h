@@ -103,6 +103,8 @@ private:
     Font m_font;
     SVGPaintServer m_fill;
     SVGPaintServer m_stroke;
+    SVGReference m_fillReference;
+    SVGReference m_strokeReference;
 
     float m_stroke_width = 1.f;
     float m_letter_spacing = 0.f;
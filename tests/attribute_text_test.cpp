@@ -0,0 +1,104 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <cstring>
+#include <string>
+
+using namespace lunasvg;
+
+static std::string makePathData(int count)
+{
+    std::string data("M0 0");
+    for(int index = 1; index <= count; ++index) {
+        data += " L" + std::to_string(index % 64) + ' ' + std::to_string(index * 7 % 48);
+    }
+
+    return data + " Z";
+}
+
+static std::string makeDocument(const std::string& pathData)
+{
+    return "<svg xmlns='http://www.w3.org/2000/svg' xmlns:xlink='http://www.w3.org/1999/xlink' width='64' height='48'>"
+           "<defs><path id='p' fill='teal' d='" + pathData + "'/></defs>"
+           "<use xlink:href='#p'/><use xlink:href='#p' transform='translate(4 4)'/>"
+           "<path id='q' fill='none' stroke='red' d='" + pathData + "'/>"
+           "</svg>";
+}
+
+static bool sameBitmap(const Bitmap& a, const Bitmap& b)
+{
+    if(a.width() != b.width() || a.height() != b.height())
+        return false;
+    for(int y = 0; y < a.height(); ++y) {
+        if(std::memcmp(a.data() + y * a.stride(), b.data() + y * b.stride(), a.width() * 4) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void testKeptByDefault(const std::string& content, const std::string& pathData)
+{
+    auto document = Document::loadFromData(content);
+    document->forceLayout();
+    document->renderToBitmap();
+    document->updateLayout();
+    CHECK(document->getElementById("p").getAttribute("d") == pathData);
+}
+
+static void testReleased(const std::string& content, const std::string& pathData)
+{
+    auto reference = Document::loadFromData(content);
+    auto document = Document::loadFromData(content);
+    document->setKeepAttributeText(false);
+    document->forceLayout();
+
+    auto element = document->getElementById("p");
+    auto regenerated = element.getAttribute("d");
+    CHECK(!regenerated.empty());
+    CHECK(regenerated != pathData);
+    CHECK(element.getAttribute("d") == regenerated);
+    CHECK(&element.getAttribute("d") == &element.getAttribute("d"));
+    CHECK(sameBitmap(document->renderToBitmap(), reference->renderToBitmap()));
+
+    auto regeneratedDocument = Document::loadFromData(makeDocument(regenerated));
+    CHECK(sameBitmap(regeneratedDocument->renderToBitmap(), reference->renderToBitmap()));
+
+    auto snapshot = document->serialize();
+    auto loaded = Document::loadFromSnapshot(snapshot.data(), snapshot.size());
+    CHECK(loaded != nullptr && sameBitmap(loaded->renderToBitmap(), reference->renderToBitmap()));
+
+    element.setAttribute("d", pathData);
+    document->updateLayout();
+    CHECK(element.getAttribute("d") != pathData);
+    CHECK(sameBitmap(document->renderToBitmap(), reference->renderToBitmap()));
+
+    document->setKeepAttributeText(true);
+    element.setAttribute("d", pathData);
+    document->forceLayout();
+    CHECK(element.getAttribute("d") == pathData);
+}
+
+static void testSharedWithClone(const std::string& content, const std::string& pathData)
+{
+    auto document = Document::loadFromData(content);
+    document->setKeepAttributeText(false);
+    auto clone = document->clone();
+    document->forceLayout();
+    CHECK(document->getElementById("q").getAttribute("d") == pathData);
+    clone.reset();
+    document->forceLayout();
+    CHECK(document->getElementById("q").getAttribute("d") != pathData);
+}
+
+int main()
+{
+    const auto pathData = makePathData(200);
+    const auto content = makeDocument(pathData);
+    testKeptByDefault(content, pathData);
+    testReleased(content, pathData);
+    testSharedWithClone(content, pathData);
+    return TEST_RESULT();
+}
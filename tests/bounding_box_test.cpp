@@ -0,0 +1,126 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <string>
+#include <vector>
+
+using namespace lunasvg;
+
+// Elements memoize their fill, stroke and paint boxes. Each case reads the boxes, changes one
+// attribute and reads them again; the second read must match a fresh load of the new source.
+struct BoundingBoxCase {
+    const char* name;
+    const char* content;
+    const char* id;
+    const char* attribute;
+    const char* oldValue;
+    const char* newValue;
+};
+
+static const BoundingBoxCase kCases[] = {
+    {"rect width", "<g id='p'><g id='q'><rect id='e' x='10' y='10' width='{}' height='20'/></g></g>", "e", "width", "20", "60"},
+    {"rect position", "<g id='p'><g id='q'><rect id='e' x='{}' y='10' width='20' height='20'/></g></g>", "e", "x", "10", "-15"},
+    {"circle radius", "<g id='p'><g id='q'><circle id='e' cx='50' cy='50' r='{}'/></g></g>", "e", "r", "10", "35"},
+    {"ellipse radius", "<g id='p'><ellipse id='e' cx='50' cy='50' rx='{}' ry='10'/><rect id='q' width='5' height='5'/></g>", "e", "rx", "10", "45"},
+    {"line end", "<g id='p'><line id='e' x1='0' y1='0' x2='{}' y2='20' stroke='black'/></g>", "e", "x2", "20", "80"},
+    {"path data", "<g id='p'><g id='q'><path id='e' d='{}'/></g></g>", "e", "d", "M10 10 L30 30 L10 30 Z", "M5 5 C40 0 60 90 90 90 Z"},
+    {"polygon points", "<g id='p'><polygon id='e' points='{}'/></g>", "e", "points", "0,0 10,0 10,10", "5,5 80,20 30,70"},
+    {"stroke width", "<g id='p'><g id='q'><rect id='e' x='20' y='20' width='20' height='20' stroke='black' stroke-width='{}'/></g></g>", "e", "stroke-width", "2", "12"},
+    {"stroke added", "<g id='p'><rect id='e' x='20' y='20' width='20' height='20' stroke='{}' stroke-width='10'/></g>", "e", "stroke", "none", "black"},
+    {"inherited stroke width", "<g id='p' stroke='black' stroke-width='{}'><g id='q'><rect id='e' x='20' y='20' width='20' height='20'/></g></g>", "p", "stroke-width", "2", "16"},
+    {"stroke linejoin", "<g id='p'><path id='e' d='M10 40 L30 10 L50 40' fill='none' stroke='black' stroke-width='8' stroke-linejoin='{}'/></g>", "e", "stroke-linejoin", "round", "miter"},
+    {"stroke miterlimit", "<g id='p'><path id='e' d='M10 40 L30 10 L50 40' fill='none' stroke='black' stroke-width='8' stroke-miterlimit='{}'/></g>", "e", "stroke-miterlimit", "1", "10"},
+    {"stroke linecap", "<g id='p'><line id='e' x1='20' y1='20' x2='60' y2='20' stroke='black' stroke-width='10' stroke-linejoin='round' stroke-linecap='{}'/></g>", "e", "stroke-linecap", "butt", "square"},
+    {"marker content", "<defs><marker id='m' markerWidth='10' markerHeight='10' refX='5' refY='5' markerUnits='userSpaceOnUse'><rect id='r' width='{}' height='10'/></marker></defs>"
+        "<g id='p'><path id='e' d='M20 20 L60 20' stroke='black' marker-end='url(#m)'/></g>", "r", "width", "10", "40"},
+    {"transform", "<g id='p'><g id='q' transform='{}'><rect id='e' width='20' height='20'/></g></g>", "q", "transform", "translate(0 0)", "translate(30 10) scale(2)"},
+    {"clip path", "<defs><clipPath id='c'><rect id='r' width='{}' height='30'/></clipPath></defs>"
+        "<g id='p'><rect id='e' width='60' height='60' clip-path='url(#c)'/></g>", "r", "width", "30", "10"},
+    {"text", "<g id='p'><text id='q' x='10' y='40' font-size='{}'>Hello<tspan id='e'> there</tspan></text></g>", "q", "font-size", "10", "20"},
+    {"tspan", "<g id='p'><text id='q' x='10' y='40' font-size='10'>Hello<tspan id='e' dx='{}'> there</tspan></text></g>", "e", "dx", "0", "30"},
+    {"use target", "<defs><rect id='t' width='{}' height='10'/></defs><g id='p'><use id='e' href='#t' x='5' y='5'/></g>", "t", "width", "10", "50"},
+    {"image size", "<g id='p'><image id='e' width='{}' height='20'/></g>", "e", "width", "20", "70"},
+    {"nested svg", "<g id='p'><svg id='e' x='10' y='10' width='30' height='30' viewBox='{}'><rect width='100' height='100'/></svg></g>", "e", "viewBox", "0 0 100 100", "0 0 50 50"},
+};
+
+static std::string makeDocument(const char* content, const char* value)
+{
+    std::string body(content);
+    auto index = body.find("{}");
+    body.replace(index, 2, value);
+    return "<svg xmlns='http://www.w3.org/2000/svg' width='100' height='100'>" + body + "</svg>";
+}
+
+static bool sameBox(const Box& a, const Box& b)
+{
+    return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+// The boxes of the changed element, its ancestors and the document, local and global.
+static std::vector<Box> collectBoxes(Document& document)
+{
+    std::vector<Box> boxes;
+    for(auto id : {"e", "p", "q"}) {
+        auto element = document.getElementById(id);
+        boxes.push_back(element.getBoundingBox());
+        boxes.push_back(element.getGlobalBoundingBox());
+    }
+
+    boxes.push_back(document.boundingBox());
+    return boxes;
+}
+
+static bool sameBoxes(const std::vector<Box>& a, const std::vector<Box>& b)
+{
+    for(size_t i = 0; i < a.size(); ++i) {
+        if(!sameBox(a[i], b[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void testBoundingBox(const BoundingBoxCase& box, bool renderFirst)
+{
+    auto document = Document::loadFromData(makeDocument(box.content, box.oldValue));
+    auto original = Document::loadFromData(makeDocument(box.content, box.oldValue));
+    auto reference = Document::loadFromData(makeDocument(box.content, box.newValue));
+    if(document == nullptr || original == nullptr || reference == nullptr) {
+        std::fprintf(stderr, "%s: failed to load\n", box.name);
+        CHECK(false);
+        return;
+    }
+
+    if(renderFirst)
+        document->renderToBitmap();
+    auto before = collectBoxes(*document);
+    CHECK(sameBoxes(before, collectBoxes(*original)));
+
+    auto element = document->getElementById(box.id);
+    element.setAttribute(box.attribute, box.newValue);
+    auto after = collectBoxes(*document);
+    CHECK(!sameBoxes(before, after));
+    if(!sameBoxes(after, collectBoxes(*reference))) {
+        std::fprintf(stderr, "%s: boxes are stale after the change\n", box.name);
+        CHECK(false);
+    }
+
+    element.setAttribute(box.attribute, box.oldValue);
+    if(!sameBoxes(before, collectBoxes(*document))) {
+        std::fprintf(stderr, "%s: boxes are stale after restoring the old value\n", box.name);
+        CHECK(false);
+    }
+}
+
+int main()
+{
+    lunasvg_add_font_face_from_file("", false, false, "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf");
+    for(const auto& box : kCases) {
+        testBoundingBox(box, false);
+        testBoundingBox(box, true);
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,210 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace lunasvg;
+
+// Checks the stylesheet cascade against a direct evaluation of every rule on every
+// element, so the id/class/tag rule buckets and the ancestor filter cannot drop a
+// match or change which rule wins.
+
+static const char* kTags[] = {"g", "rect", "circle", "svg"};
+static const char* kClasses[] = {"a", "b", "c", "d"};
+
+struct TreeNode {
+    int parent;
+    int tag;
+    unsigned classes;
+};
+
+struct Compound {
+    int tag = -1;
+    int classIndex = -1;
+    int id = -1;
+};
+
+struct Rule {
+    bool hasAncestor = false;
+    bool child = false;
+    Compound ancestor;
+    Compound subject;
+    std::string fill;
+};
+
+static std::string elementId(int index)
+{
+    return "e" + std::to_string(index);
+}
+
+static std::string selectorText(const Compound& compound)
+{
+    std::string text(compound.tag < 0 ? "*" : kTags[compound.tag]);
+    if(compound.classIndex >= 0)
+        text += std::string(".") + kClasses[compound.classIndex];
+    if(compound.id >= 0)
+        text += "#" + elementId(compound.id);
+    return text;
+}
+
+static int specificity(const Compound& compound)
+{
+    return (compound.tag >= 0 ? 0x1 : 0) + (compound.classIndex >= 0 ? 0x100 : 0) + (compound.id >= 0 ? 0x10000 : 0);
+}
+
+static bool matches(const Compound& compound, const std::vector<TreeNode>& nodes, int index)
+{
+    const auto& node = nodes[index];
+    return (compound.tag < 0 || compound.tag == node.tag)
+        && (compound.classIndex < 0 || (node.classes & (1u << compound.classIndex)))
+        && (compound.id < 0 || compound.id == index);
+}
+
+static bool matches(const Rule& rule, const std::vector<TreeNode>& nodes, int index)
+{
+    if(!matches(rule.subject, nodes, index))
+        return false;
+    if(!rule.hasAncestor)
+        return true;
+    for(auto parent = nodes[index].parent; parent >= 0; parent = nodes[parent].parent) {
+        if(matches(rule.ancestor, nodes, parent))
+            return true;
+        if(rule.child) {
+            break;
+        }
+    }
+
+    return false;
+}
+
+static Compound makeCompound(std::mt19937& random, int nodeCount)
+{
+    Compound compound;
+    if(random() % 3)
+        compound.tag = random() % 4;
+    if(random() % 2)
+        compound.classIndex = random() % 4;
+    if(random() % 5 == 0)
+        compound.id = random() % nodeCount;
+    return compound;
+}
+
+static void testRandomCascade(std::mt19937& random)
+{
+    std::vector<TreeNode> nodes = {{-1, 3, 0}};
+    std::string content("<svg xmlns='http://www.w3.org/2000/svg' id='e0' width='10' height='10'>");
+    std::vector<int> stack = {0};
+    const int nodeCount = 40 + random() % 40;
+    for(int index = 1; index < nodeCount; ++index) {
+        while(stack.size() > 5 || (stack.size() > 1 && random() % 3 == 0)) {
+            content += "</g>";
+            stack.pop_back();
+        }
+
+        TreeNode node = {stack.back(), static_cast<int>(random() % 3), static_cast<unsigned>(random() % 16)};
+        nodes.push_back(node);
+        content += "<" + std::string(kTags[node.tag]) + " id='" + elementId(index) + "' class='";
+        for(int bit = 0; bit < 4; ++bit) {
+            if(node.classes & (1u << bit)) {
+                content += std::string(" ") + kClasses[bit];
+            }
+        }
+
+        if(node.tag == 0) {
+            content += "'>";
+            stack.push_back(index);
+        } else {
+            content += "'/>";
+        }
+    }
+
+    for(size_t index = 1; index < stack.size(); ++index)
+        content += "</g>";
+    content += "</svg>";
+
+    std::vector<Rule> rules;
+    std::string styleSheet;
+    const int ruleCount = 10 + random() % 30;
+    for(int index = 0; index < ruleCount; ++index) {
+        Rule rule;
+        rule.subject = makeCompound(random, nodeCount);
+        if(random() % 2) {
+            rule.hasAncestor = true;
+            rule.child = random() % 2;
+            rule.ancestor = makeCompound(random, nodeCount);
+        }
+
+        char fill[8];
+        std::snprintf(fill, sizeof(fill), "#%06x", index + 1);
+        rule.fill = fill;
+        if(rule.hasAncestor)
+            styleSheet += selectorText(rule.ancestor) + (rule.child ? " > " : " ");
+        styleSheet += selectorText(rule.subject) + " { fill: " + rule.fill + " }\n";
+        rules.push_back(rule);
+    }
+
+    auto document = Document::loadFromData(content);
+    CHECK(document != nullptr);
+    if(document == nullptr)
+        return;
+    document->applyStyleSheet(styleSheet);
+    for(int index = 0; index < nodeCount; ++index) {
+        const Rule* winner = nullptr;
+        int winnerSpecificity = -1;
+        for(const auto& rule : rules) {
+            if(!matches(rule, nodes, index))
+                continue;
+            auto value = specificity(rule.subject) + (rule.hasAncestor ? specificity(rule.ancestor) : 0);
+            if(value >= winnerSpecificity) {
+                winner = &rule;
+                winnerSpecificity = value;
+            }
+        }
+
+        const auto& fill = document->getElementById(elementId(index)).getAttribute("fill");
+        if(fill != (winner ? winner->fill : std::string())) {
+            std::fprintf(stderr, "element %s: got '%s', expected '%s'\n%s", elementId(index).c_str(), fill.c_str(), winner ? winner->fill.c_str() : "", styleSheet.c_str());
+            CHECK(false);
+            return;
+        }
+    }
+}
+
+static void testFixedCascade()
+{
+    auto document = Document::loadFromData(
+        "<svg xmlns='http://www.w3.org/2000/svg'>"
+        "<g id='outer' class='x'><g class='y'><rect id='r' class='a b'/><circle id='c'/></g></g>"
+        "<rect id='s' class='a'/>"
+        "</svg>");
+    document->applyStyleSheet(
+        "#r { fill: #000001 }\n"
+        "rect.a.b { fill: #000002 }\n"
+        "* { fill: #000003; stroke: #000003 }\n"
+        ".x rect { stroke: #000004 }\n"
+        "rect { stroke: #000005 }\n"
+        "#outer > * circle { fill: #000006 }\n"
+        "#outer > circle { stroke: #000007 }\n"
+        ".y > * { stroke-width: 2 }\n");
+    CHECK(document->getElementById("r").getAttribute("fill") == "#000001");
+    CHECK(document->getElementById("r").getAttribute("stroke") == "#000004");
+    CHECK(document->getElementById("r").getAttribute("stroke-width") == "2");
+    CHECK(document->getElementById("c").getAttribute("fill") == "#000006");
+    CHECK(document->getElementById("c").getAttribute("stroke") == "#000003");
+    CHECK(document->getElementById("s").getAttribute("fill") == "#000003");
+    CHECK(document->getElementById("s").getAttribute("stroke") == "#000005");
+    CHECK(document->getElementById("s").getAttribute("stroke-width").empty());
+    CHECK(document->getElementById("outer").getAttribute("fill") == "#000003");
+}
+
+int main()
+{
+    testFixedCascade();
+    std::mt19937 random(20260101);
+    for(int iteration = 0; iteration < 200; ++iteration)
+        testRandomCascade(random);
+    return TEST_RESULT();
+}
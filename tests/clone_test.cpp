@@ -0,0 +1,134 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace lunasvg;
+
+static std::string makeDataUri(int width, int height)
+{
+    Bitmap bitmap(width, height);
+    bitmap.clear(0x336699FF);
+    std::vector<uint8_t> data;
+    bitmap.writeToPng([](void* closure, void* bytes, int size) {
+        auto output = static_cast<std::vector<uint8_t>*>(closure);
+        output->insert(output->end(), static_cast<uint8_t*>(bytes), static_cast<uint8_t*>(bytes) + size);
+    }, &data);
+
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string output("data:image/png;base64,");
+    size_t index = 0;
+    for(; index + 2 < data.size(); index += 3) {
+        uint32_t value = data[index] << 16 | data[index + 1] << 8 | data[index + 2];
+        output += table[value >> 18];
+        output += table[(value >> 12) & 0x3F];
+        output += table[(value >> 6) & 0x3F];
+        output += table[value & 0x3F];
+    }
+
+    if(index < data.size()) {
+        uint32_t value = data[index] << 16;
+        if(index + 1 < data.size())
+            value |= data[index + 1] << 8;
+        output += table[value >> 18];
+        output += table[(value >> 12) & 0x3F];
+        output += index + 1 < data.size() ? table[(value >> 6) & 0x3F] : '=';
+        output += '=';
+    }
+
+    return output;
+}
+
+static bool isPainted(const Bitmap& bitmap, int x, int y)
+{
+    return bitmap.data()[y * bitmap.stride() + x * 4 + 3] != 0;
+}
+
+static std::string makeImageDocument(const std::string& href)
+{
+    return "<svg xmlns='http://www.w3.org/2000/svg' xmlns:xlink='http://www.w3.org/1999/xlink' width='20' height='10'>"
+           "<defs><image id='k' width='10' height='10' href='" + href + "'/></defs>"
+           "<image id='i' width='10' height='10'/>"
+           "<use xlink:href='#k' x='10'/>"
+           "</svg>";
+}
+
+static void testCloneOutlivesSource()
+{
+    auto source = Document::loadFromData(makeImageDocument(makeDataUri(10, 10)));
+    source->getElementById("i").setAttribute("href", makeDataUri(10, 10));
+    auto clone = source->clone();
+    source.reset();
+
+    auto bitmap = clone->renderToBitmap();
+    CHECK(isPainted(bitmap, 5, 5));
+    CHECK(isPainted(bitmap, 15, 5));
+}
+
+static bool sameBitmap(const Bitmap& a, const Bitmap& b)
+{
+    if(a.width() != b.width() || a.height() != b.height())
+        return false;
+    for(int y = 0; y < a.height(); ++y) {
+        if(std::memcmp(a.data() + y * a.stride(), b.data() + y * b.stride(), a.width() * 4) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static const char shapeDocument[] = R"SVG(
+<svg xmlns="http://www.w3.org/2000/svg" xmlns:xlink="http://www.w3.org/1999/xlink" width="40" height="20">
+  <defs><linearGradient id="g"><stop offset="0" stop-color="red"/></linearGradient></defs>
+  <rect id="r" width="10" height="10" fill="url(#g)"/>
+  <path id="p" d="M20 0h10v10h-10z" fill="blue"/>
+  <use xlink:href="#p" x="10" y="10"/>
+</svg>
+)SVG";
+
+static void mutate(Document* document)
+{
+    document->getElementById("r").setAttribute("fill", "green");
+    document->getElementById("p").setAttribute("d", "M0 10h5v5h-5z");
+    document->getElementById("g").setAttribute("id", "h");
+    document->getElementById("r").setAttribute("id", "s");
+}
+
+static void checkUnchanged(Document* document, const Bitmap& expected)
+{
+    CHECK(!document->getElementById("r").isNull());
+    CHECK(!document->getElementById("g").isNull());
+    CHECK(document->getElementById("s").isNull());
+    CHECK(document->getElementById("h").isNull());
+    CHECK(document->getElementById("r").getAttribute("fill") == "url(#g)");
+    CHECK(document->getElementById("p").getAttribute("d") == "M20 0h10v10h-10z");
+    CHECK(sameBitmap(document->renderToBitmap(), expected));
+}
+
+static void testCloneIsIndependent()
+{
+    auto source = Document::loadFromData(shapeDocument);
+    const auto expected = source->renderToBitmap();
+
+    auto clone = source->clone();
+    mutate(clone.get());
+    checkUnchanged(source.get(), expected);
+    CHECK(!clone->getElementById("s").isNull());
+    CHECK(clone->getElementById("p").getAttribute("d") == "M0 10h5v5h-5z");
+    CHECK(!sameBitmap(clone->renderToBitmap(), expected));
+
+    clone = source->clone();
+    mutate(source.get());
+    checkUnchanged(clone.get(), expected);
+}
+
+int main()
+{
+    testCloneOutlivesSource();
+    testCloneIsIndependent();
+    return TEST_RESULT();
+}
@@ -0,0 +1,78 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <cstring>
+#include <string>
+
+using namespace lunasvg;
+
+static const char kRectDocument[] =
+    "<svg xmlns='http://www.w3.org/2000/svg' width='64' height='64'>"
+    "<rect id='r' x='5' y='5' width='10' height='10'/>"
+    "</svg>";
+
+static const char kStyledDocument[] =
+    "<svg xmlns='http://www.w3.org/2000/svg' width='64' height='64'>"
+    "<style>%s</style>"
+    "<rect id='r' x='16' y='16' width='32' height='32' fill='none' stroke='black' stroke-width='6'/>"
+    "</svg>";
+
+static std::unique_ptr<Document> load(const std::string& content, bool defer)
+{
+    ParseOptions options;
+    options.deferAttributeParsing = defer;
+    return Document::loadFromData(content.data(), content.size(), options);
+}
+
+static std::string makeStyledDocument(const char* styleSheet)
+{
+    char buffer[512];
+    std::snprintf(buffer, sizeof(buffer), kStyledDocument, styleSheet);
+    return buffer;
+}
+
+static bool sameBitmap(const Bitmap& a, const Bitmap& b)
+{
+    if(a.width() != b.width() || a.height() != b.height())
+        return false;
+    for(int y = 0; y < a.height(); ++y) {
+        if(std::memcmp(a.data() + y * a.stride(), b.data() + y * b.stride(), a.width() * 4) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void testInvalidOverrideKeepsLastValue(bool defer, bool layoutBetween)
+{
+    auto document = load(kRectDocument, defer);
+    auto element = document->getElementById("r");
+    element.setAttribute("x", "20");
+    if(layoutBetween)
+        document->updateLayout();
+    element.setAttribute("x", "bogus");
+    CHECK(element.getBoundingBox().x == 20.f);
+    CHECK(element.getAttribute("x") == "bogus");
+}
+
+static void testDeferredMatchesEager()
+{
+    const auto content = makeStyledDocument("#r { stroke-width: 3 }");
+    auto eager = load(content, false);
+    auto deferred = load(content, true);
+    CHECK(sameBitmap(deferred->renderToBitmap(), eager->renderToBitmap()));
+}
+
+int main()
+{
+    CHECK(!ParseOptions().deferAttributeParsing);
+    for(bool defer : {false, true}) {
+        testInvalidOverrideKeepsLastValue(defer, false);
+        testInvalidOverrideKeepsLastValue(defer, true);
+    }
+
+    testDeferredMatchesEager();
+    return TEST_RESULT();
+}
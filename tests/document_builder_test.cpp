@@ -0,0 +1,79 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <cstring>
+#include <string>
+
+using namespace lunasvg;
+
+// Every split point of this fixture is tried, so it covers splits inside the XML
+// declaration, the DOCTYPE and its internal subset, comments, CDATA sections,
+// quoted attribute values containing '>' and entity references in text.
+static const char kFixture[] =
+    "\xEF\xBB\xBF<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" \"svg11.dtd\" [ <!ENTITY e \"[x]\"> ]>\n"
+    "<!-- leading comment with > and \"quotes\" -->\n"
+    "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"40\" height=\"30\" viewBox=\"0 0 40 30\">\n"
+    "  <style><![CDATA[ rect.a { fill: teal } /* ]] > */ ]]></style>\n"
+    "  <!-- a comment with <rect/> inside -->\n"
+    "  <rect class=\"a\" x=\"2\" y=\"2\" width=\"10\" height=\"10\" data-x='a>b \"c\"'/>\n"
+    "  <path id=\"p\" d=\"M20 2 L30 2 L25 12 Z\" fill=\"orange\" stroke=\"navy\" stroke-dasharray='2 1'/>\n"
+    "  <text x=\"2\" y=\"28\" font-size=\"6\">A &lt;b&gt; &#65;<tspan fill=\"navy\"><![CDATA[<c>]]></tspan></text>\n"
+    "</svg>\n";
+
+static bool sameBitmap(const Bitmap& a, const Bitmap& b)
+{
+    if(a.width() != b.width() || a.height() != b.height())
+        return false;
+    for(int y = 0; y < a.height(); ++y) {
+        if(std::memcmp(a.data() + y * a.stride(), b.data() + y * b.stride(), a.width() * 4) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool sameDocument(const Document* document, const Document* reference)
+{
+    return document
+        && document->serialize() == reference->serialize()
+        && document->getElementById("p").getAttribute("d") == reference->getElementById("p").getAttribute("d")
+        && sameBitmap(document->renderToBitmap(), reference->renderToBitmap());
+}
+
+static void testSplitPoints(const std::string& content, const Document* reference)
+{
+    for(size_t split = 0; split <= content.size(); ++split) {
+        DocumentBuilder builder;
+        bool fed = builder.feed(content.data(), split) && builder.feed(content.data() + split, content.size() - split);
+        auto document = builder.finish();
+        if(!fed || !sameDocument(document.get(), reference)) {
+            std::fprintf(stderr, "split at byte %zu: \"%.20s\"\n", split, content.c_str() + split);
+            CHECK(false);
+        }
+    }
+}
+
+static void testByteAtATime(const std::string& content, const Document* reference)
+{
+    DocumentBuilder builder;
+    bool fed = true;
+    for(auto ch : content)
+        fed &= builder.feed(&ch, 1);
+    auto document = builder.finish();
+    CHECK(fed && sameDocument(document.get(), reference));
+}
+
+int main()
+{
+    const std::string content(kFixture);
+    auto reference = Document::loadFromData(content);
+    CHECK(reference != nullptr);
+    if(reference == nullptr)
+        return TEST_RESULT();
+    testSplitPoints(content, reference.get());
+    testByteAtATime(content, reference.get());
+    return TEST_RESULT();
+}
@@ -0,0 +1,35 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+using namespace lunasvg;
+
+static const char content[] = R"SVG(
+<svg xmlns="http://www.w3.org/2000/svg" xmlns:xlink="http://www.w3.org/1999/xlink" width="20" height="20">
+  <use xlink:href="#b"/>
+  <defs><rect id="a" width="10" height="10"/></defs>
+  <use xlink:href="#a"/>
+  <rect id="b" width="5" height="5"/>
+  <rect id="c" width="5" height="5"/>
+</svg>
+)SVG";
+
+int main()
+{
+    auto document = Document::loadFromData(content);
+    document->forceLayout();
+
+    auto a = document->getElementById("a");
+    a.setAttribute("id", "d");
+    CHECK(document->getElementById("a").isNull());
+    CHECK(document->getElementById("d") == a);
+
+    auto b = document->getElementById("b");
+    auto c = document->getElementById("c");
+    c.setAttribute("id", "b");
+    CHECK(document->getElementById("b") == b);
+    b.setAttribute("id", "e");
+    CHECK(document->getElementById("b") == c);
+    CHECK(document->getElementById("e") == b);
+    return TEST_RESULT();
+}
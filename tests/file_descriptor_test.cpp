@@ -0,0 +1,168 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace lunasvg;
+
+// Regular files are mapped and read from the start; pipes fall back to reading from the
+// current position. The documents are large enough that the fallback reads several chunks.
+
+static std::string makeDocument()
+{
+    static const char* colors[] = {"teal", "orange", "navy", "gold"};
+    std::string content("<svg xmlns='http://www.w3.org/2000/svg' width='64' height='64'>");
+    for(int index = 0; index < 4096; ++index) {
+        content += "<rect x='" + std::to_string(index % 64) + "' y='" + std::to_string(index / 64) + "'";
+        content += " width='1' height='1' fill='" + std::string(colors[index % 4]) + "'/>";
+    }
+
+    return content + "</svg>";
+}
+
+static bool sameBitmap(const Bitmap& a, const Bitmap& b)
+{
+    if(a.isNull() || a.width() != b.width() || a.height() != b.height())
+        return false;
+    for(int y = 0; y < a.height(); ++y) {
+        if(std::memcmp(a.data() + y * a.stride(), b.data() + y * b.stride(), a.width() * 4) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool writeAll(int fd, const std::string& data)
+{
+    size_t offset = 0;
+    while(offset < data.size()) {
+        auto count = write(fd, data.data() + offset, data.size() - offset);
+        if(count <= 0)
+            return false;
+        offset += count;
+    }
+
+    return true;
+}
+
+static int createFile(const std::string& data)
+{
+    char path[] = "/tmp/lunasvg_fd_XXXXXX";
+    auto fd = mkstemp(path);
+    if(fd == -1)
+        return -1;
+    unlink(path);
+    if(!writeAll(fd, data)) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static void testRegularFile(const Bitmap& expected, const std::string& data)
+{
+    auto fd = createFile(data);
+    CHECK(fd != -1);
+
+    // The offset is at the end of the file after writing; move it somewhere else as well.
+    for(auto offset : {static_cast<off_t>(data.size()), static_cast<off_t>(17)}) {
+        CHECK(lseek(fd, offset, SEEK_SET) == offset);
+        auto document = Document::loadFromFile(fd);
+        CHECK(document && sameBitmap(expected, document->renderToBitmap()));
+
+        ParseError error = ParseError::ReadFailed;
+        document = Document::loadFromFile(fd, ParseOptions(), &error);
+        CHECK(error == ParseError::None);
+        CHECK(document && sameBitmap(expected, document->renderToBitmap()));
+        CHECK(lseek(fd, 0, SEEK_CUR) == offset);
+    }
+
+    ParseOptions options;
+    options.maxElements = 100;
+    ParseError error = ParseError::None;
+    CHECK(Document::loadFromFile(fd, options, &error) == nullptr);
+    CHECK(error == ParseError::TooManyElements);
+    close(fd);
+}
+
+static void testEmptyFile()
+{
+    auto fd = createFile(std::string());
+    CHECK(fd != -1);
+    ParseError error = ParseError::None;
+    CHECK(Document::loadFromFile(fd, ParseOptions(), &error) == nullptr);
+    CHECK(error == ParseError::InvalidDocument);
+    close(fd);
+}
+
+static void testPipe(const Bitmap& expected, const std::string& data, size_t skip)
+{
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+
+    // A preamble is consumed before loading, so the pipe is not at its first byte.
+    const std::string preamble(skip, '#');
+    std::thread writer([&] {
+        writeAll(fds[1], preamble + data);
+        close(fds[1]);
+    });
+
+    char buffer[64];
+    size_t consumed = 0;
+    while(consumed < skip) {
+        auto count = read(fds[0], buffer, std::min(sizeof(buffer), skip - consumed));
+        if(count <= 0)
+            break;
+        consumed += count;
+    }
+
+    ParseError error = ParseError::ReadFailed;
+    auto document = Document::loadFromFile(fds[0], ParseOptions(), &error);
+    writer.join();
+    close(fds[0]);
+
+    CHECK(consumed == skip);
+    CHECK(error == ParseError::None);
+    CHECK(document && sameBitmap(expected, document->renderToBitmap()));
+}
+
+static void testInvalidDescriptor()
+{
+    ParseError error = ParseError::None;
+    CHECK(Document::loadFromFile(-1) == nullptr);
+    CHECK(Document::loadFromFile(-1, ParseOptions(), &error) == nullptr);
+    CHECK(error == ParseError::ReadFailed);
+
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    close(fds[0]);
+    error = ParseError::None;
+    CHECK(Document::loadFromFile(fds[0], ParseOptions(), &error) == nullptr);
+    CHECK(error == ParseError::ReadFailed);
+    close(fds[1]);
+}
+
+int main()
+{
+    const auto data = makeDocument();
+    auto reference = Document::loadFromData(data);
+    CHECK(reference != nullptr);
+    const auto expected = reference->renderToBitmap();
+
+    testRegularFile(expected, data);
+    testEmptyFile();
+    testPipe(expected, data, 0);
+    testPipe(expected, data, 100);
+    testInvalidDescriptor();
+    return TEST_RESULT();
+}
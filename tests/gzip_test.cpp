@@ -0,0 +1,142 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace lunasvg;
+
+// gzip -9 of makeDocument(); the member uses a dynamic Huffman block.
+static const uint8_t compressedDocument[] = {
+    0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x9D, 0xD4, 0xD1, 0x0A, 0x82, 0x30,
+    0x14, 0xC6, 0xF1, 0x57, 0x39, 0x9C, 0x07, 0x68, 0x6B, 0x1B, 0x63, 0x84, 0xEB, 0xA2, 0x37, 0x91,
+    0x5A, 0x2A, 0x98, 0x86, 0x0D, 0xA7, 0x6F, 0x9F, 0xA6, 0x60, 0xE5, 0xCD, 0x76, 0x6E, 0x44, 0x86,
+    0x7F, 0xF8, 0xC1, 0xC7, 0xCC, 0x5E, 0x7D, 0x01, 0xC3, 0xA3, 0x6E, 0x5E, 0x16, 0x4B, 0xEF, 0x9F,
+    0x27, 0xC6, 0x42, 0x08, 0x87, 0x20, 0x0F, 0x6D, 0x57, 0x30, 0xC1, 0x39, 0x67, 0xD3, 0x17, 0x08,
+    0xA1, 0xBA, 0xF9, 0xD2, 0xA2, 0x32, 0x08, 0xA5, 0xAB, 0x8A, 0xD2, 0x5B, 0x94, 0x02, 0xA1, 0xAF,
+    0x5C, 0xB8, 0xB4, 0x83, 0x45, 0x0E, 0x1C, 0x94, 0x81, 0xE9, 0xEC, 0x9C, 0x75, 0xEE, 0xEA, 0x61,
+    0x3E, 0x43, 0x18, 0x3F, 0xCF, 0x35, 0xD6, 0x5B, 0x3B, 0xBD, 0xDE, 0xAB, 0xBA, 0xB6, 0xE8, 0x5D,
+    0x5E, 0x23, 0xDB, 0x1A, 0x1D, 0xD1, 0xB4, 0x5D, 0xDE, 0x14, 0xEE, 0xBB, 0x3A, 0x8A, 0x88, 0xAC,
+    0xC9, 0xFB, 0xF1, 0x27, 0x32, 0x04, 0x9F, 0x50, 0x24, 0xA0, 0xE4, 0x04, 0xA0, 0xD4, 0x04, 0xA0,
+    0x12, 0x24, 0xE0, 0xE2, 0x33, 0x49, 0x3E, 0x1D, 0xD1, 0xFC, 0xF3, 0xD6, 0xA5, 0x4C, 0xEA, 0xC0,
+    0x86, 0xE0, 0x5B, 0xB7, 0x4A, 0x03, 0x4A, 0x4E, 0x02, 0x4A, 0x4D, 0x00, 0x2A, 0x41, 0x00, 0x2E,
+    0xBE, 0xA3, 0x4E, 0x04, 0xEA, 0x98, 0x6C, 0x77, 0x45, 0x44, 0x4C, 0xB5, 0xDB, 0xD8, 0xD0, 0x88,
+    0xEB, 0x5E, 0x89, 0x46, 0xC9, 0x29, 0x46, 0xA9, 0x69, 0x46, 0x25, 0x52, 0x8C, 0xF3, 0xBF, 0xF3,
+    0xFC, 0x06, 0xDA, 0xB6, 0x2D, 0x7D, 0x63, 0x05, 0x00, 0x00,
+};
+
+static std::string makeDocument()
+{
+    static const char* colors[] = {"teal", "orange", "navy"};
+    std::string content("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"48\" height=\"32\" viewBox=\"0 0 48 32\">");
+    for(int index = 0; index < 24; ++index) {
+        content += "<rect x=\"" + std::to_string(index * 6 % 48) + "\" y=\"" + std::to_string(index * 6 / 48 * 8) + "\"";
+        content += " width=\"6\" height=\"6\" fill=\"" + std::string(colors[index % 3]) + "\"/>";
+    }
+
+    return content + "</svg>";
+}
+
+static void appendLittleEndian(std::string& output, uint32_t value, int count)
+{
+    for(int index = 0; index < count; ++index) {
+        output += static_cast<char>(value >> (8 * index));
+    }
+}
+
+static std::string makeStoredGzip(const std::string& content, size_t blockSize)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for(auto value : content) {
+        crc ^= static_cast<uint8_t>(value);
+        for(int bit = 0; bit < 8; ++bit) {
+            crc = crc & 1 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+        }
+    }
+
+    std::string output("\x1F\x8B\x08\x08\0\0\0\0\0\x03", 10);
+    output.append("image.svg", 10);
+    for(size_t offset = 0; offset < content.size(); offset += blockSize) {
+        const auto length = std::min(blockSize, content.size() - offset);
+        output += static_cast<char>(offset + length == content.size());
+        appendLittleEndian(output, length, 2);
+        appendLittleEndian(output, ~length & 0xFFFF, 2);
+        output.append(content, offset, length);
+    }
+
+    appendLittleEndian(output, crc ^ 0xFFFFFFFF, 4);
+    appendLittleEndian(output, content.size(), 4);
+    return output;
+}
+
+static bool sameBitmap(const Bitmap& a, const Bitmap& b)
+{
+    if(a.isNull() || a.width() != b.width() || a.height() != b.height())
+        return false;
+    for(int y = 0; y < a.height(); ++y) {
+        if(std::memcmp(a.data() + y * a.stride(), b.data() + y * b.stride(), a.width() * 4) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static std::unique_ptr<Document> build(const std::string& data, size_t chunkSize, const ParseOptions& options = ParseOptions())
+{
+    DocumentBuilder builder(options);
+    for(size_t offset = 0; offset < data.size(); offset += chunkSize) {
+        if(!builder.feed(data.data() + offset, std::min(chunkSize, data.size() - offset))) {
+            return nullptr;
+        }
+    }
+
+    return builder.finish();
+}
+
+int main()
+{
+    const auto content = makeDocument();
+    const std::string compressed(reinterpret_cast<const char*>(compressedDocument), sizeof(compressedDocument));
+    const auto stored = makeStoredGzip(content, 300);
+    const auto expected = Document::loadFromData(content)->renderToBitmap();
+
+    for(const auto& data : {compressed, stored}) {
+        auto document = Document::loadFromData(data.data(), data.size());
+        CHECK(document != nullptr && sameBitmap(document->renderToBitmap(), expected));
+        for(size_t chunkSize : {1, 7, 4096}) {
+            document = build(data, chunkSize);
+            CHECK(document != nullptr && sameBitmap(document->renderToBitmap(), expected));
+        }
+
+        float width = 0, height = 0;
+        Box viewBox;
+        CHECK(Document::probe(data.data(), data.size(), width, height, viewBox));
+        CHECK(width == 48 && height == 32 && viewBox.w == 48 && viewBox.h == 32);
+
+        auto truncated = data.substr(0, data.size() - 1);
+        CHECK(Document::loadFromData(truncated.data(), truncated.size()) == nullptr);
+        CHECK(build(truncated, 7) == nullptr);
+
+        auto corrupted = data;
+        corrupted[corrupted.size() - 6] ^= 1;
+        CHECK(Document::loadFromData(corrupted.data(), corrupted.size()) == nullptr);
+        CHECK(build(corrupted, 7) == nullptr);
+
+        auto trailing = data + '\0';
+        CHECK(Document::loadFromData(trailing.data(), trailing.size()) == nullptr);
+
+        ParseOptions options;
+        options.maxDataSize = content.size() - 1;
+        ParseError error;
+        CHECK(Document::loadFromData(data.data(), data.size(), options, &error) == nullptr);
+        CHECK(error == ParseError::DataTooLarge);
+        DocumentBuilder builder(options);
+        CHECK(!builder.feed(data.data(), data.size()));
+        CHECK(builder.error() == ParseError::DataTooLarge);
+    }
+
+    return TEST_RESULT();
+}
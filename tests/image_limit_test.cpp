@@ -0,0 +1,100 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <string>
+#include <vector>
+
+using namespace lunasvg;
+
+static std::string makeDataUri(int width, int height)
+{
+    Bitmap bitmap(width, height);
+    bitmap.clear(0x336699FF);
+    std::vector<uint8_t> data;
+    bitmap.writeToPng([](void* closure, void* bytes, int size) {
+        auto output = static_cast<std::vector<uint8_t>*>(closure);
+        output->insert(output->end(), static_cast<uint8_t*>(bytes), static_cast<uint8_t*>(bytes) + size);
+    }, &data);
+
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string output("data:image/png;base64,");
+    size_t index = 0;
+    for(; index + 2 < data.size(); index += 3) {
+        uint32_t value = data[index] << 16 | data[index + 1] << 8 | data[index + 2];
+        output += table[value >> 18];
+        output += table[(value >> 12) & 0x3F];
+        output += table[(value >> 6) & 0x3F];
+        output += table[value & 0x3F];
+        if(index % 48 == 0) {
+            output += "\n ";
+        }
+    }
+
+    if(index < data.size()) {
+        uint32_t value = data[index] << 16;
+        if(index + 1 < data.size())
+            value |= data[index + 1] << 8;
+        output += table[value >> 18];
+        output += table[(value >> 12) & 0x3F];
+        output += index + 1 < data.size() ? table[(value >> 6) & 0x3F] : '=';
+        output += '=';
+    }
+
+    return output;
+}
+
+static std::string makeDocument(const std::string& first, const std::string& second)
+{
+    return "<svg xmlns='http://www.w3.org/2000/svg' width='20' height='20'>"
+           "<image id='a' width='10' height='10' href='" + first + "'/>"
+           "<image id='b' x='10' width='10' height='10' href='" + second + "'/>"
+           "</svg>";
+}
+
+static bool isPainted(const Bitmap& bitmap, int x, int y)
+{
+    return bitmap.data()[y * bitmap.stride() + x * 4 + 3] != 0;
+}
+
+static std::unique_ptr<Document> load(const std::string& content, size_t maxImagePixels, ParseError& error)
+{
+    ParseOptions options;
+    options.maxImagePixels = maxImagePixels;
+    return Document::loadFromData(content.data(), content.size(), options, &error);
+}
+
+int main()
+{
+    const auto small = makeDataUri(40, 30);
+    const auto large = makeDataUri(300, 200);
+    ParseError error;
+
+    CHECK(load(makeDocument(small, small), 40 * 30, error) != nullptr);
+    CHECK(error == ParseError::None);
+    CHECK(load(makeDocument(small, large), 40 * 30 + 300 * 200, error) != nullptr);
+    CHECK(load(makeDocument(small, large), 40 * 30 + 300 * 200 - 1, error) == nullptr);
+    CHECK(error == ParseError::ImagesTooLarge);
+
+    auto document = load(makeDocument(small, small), 2 * 40 * 30, error);
+    CHECK(document != nullptr);
+    if(document == nullptr)
+        return TEST_RESULT();
+    auto bitmap = document->renderToBitmap();
+    CHECK(isPainted(bitmap, 5, 5));
+    CHECK(isPainted(bitmap, 15, 5));
+
+    document->getElementById("b").setAttribute("href", large);
+    bitmap = document->renderToBitmap();
+    CHECK(isPainted(bitmap, 5, 5));
+    CHECK(!isPainted(bitmap, 15, 5));
+
+    document->getElementById("b").setAttribute("href", makeDataUri(30, 40));
+    bitmap = document->renderToBitmap();
+    CHECK(isPainted(bitmap, 15, 5));
+
+    document->getElementById("a").setAttribute("href", makeDataUri(10, 10));
+    bitmap = document->renderToBitmap();
+    CHECK(!isPainted(bitmap, 5, 5));
+    return TEST_RESULT();
+}
@@ -0,0 +1,171 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <cstring>
+#include <string>
+
+using namespace lunasvg;
+
+// Each case renders a document, changes one attribute and renders again. The result
+// must match a fresh load of the same source with the new value written in.
+struct MutationCase {
+    const char* name;
+    const char* content;
+    const char* id;
+    const char* attribute;
+    const char* oldValue;
+    const char* newValue;
+};
+
+static const MutationCase kCases[] = {
+    {"plain shape", "<rect id='e' x='4' y='4' width='{}' height='20' fill='teal'/>", "e", "width", "10", "30"},
+    {"shape transform", "<g id='e' transform='{}'><circle cx='10' cy='10' r='8' fill='navy'/></g>", "e", "transform", "translate(0 0)", "translate(20 12)"},
+    {"inherited paint", "<g id='e' fill='{}'><rect width='20' height='20'/><rect x='24' width='20' height='20' fill='gray'/></g>", "e", "fill", "red", "green"},
+    {"stroke width", "<rect id='e' x='10' y='10' width='20' height='20' fill='none' stroke='black' stroke-width='{}'/>", "e", "stroke-width", "1", "6"},
+    {"tspan offset", "<text x='2' y='24' font-size='16'>AB<tspan id='e' fill='red' dx='{}'>CD</tspan>EF</text>", "e", "dx", "0", "12"},
+    {"tspan font size", "<text x='2' y='30' font-size='12'>AB<tspan id='e' font-size='{}'>CD</tspan>EF</text>", "e", "font-size", "12", "24"},
+    {"clip path child",
+        "<clipPath id='c'><rect id='e' width='{}' height='30'/></clipPath>"
+        "<rect width='48' height='48' fill='blue' clip-path='url(#c)'/>", "e", "width", "10", "35"},
+    {"clip path units",
+        "<clipPath id='e' clipPathUnits='{}'><rect width='0.5' height='0.5'/></clipPath>"
+        "<rect x='8' y='8' width='32' height='32' fill='blue' clip-path='url(#e)'/>", "e", "clipPathUnits", "userSpaceOnUse", "objectBoundingBox"},
+    {"mask child",
+        "<mask id='m'><rect id='e' width='48' height='48' fill='{}'/></mask>"
+        "<rect width='48' height='48' fill='orange' mask='url(#m)'/>", "e", "fill", "white", "#404040"},
+    {"marker child",
+        "<marker id='m' markerWidth='10' markerHeight='10' refX='5' refY='5'><circle id='e' cx='5' cy='5' r='{}' fill='red'/></marker>"
+        "<path d='M5 5 L40 5 L40 40' stroke='black' marker-mid='url(#m)' marker-end='url(#m)'/>", "e", "r", "2", "5"},
+    {"marker size",
+        "<marker id='e' markerWidth='{}' markerHeight='10' refX='5' refY='5'><rect width='10' height='10' fill='red'/></marker>"
+        "<path d='M5 5 L40 5 L40 40' stroke='black' marker-end='url(#e)'/>", "e", "markerWidth", "10", "4"},
+    {"gradient stop",
+        "<linearGradient id='g'><stop offset='0' stop-color='white'/><stop id='e' offset='1' stop-color='{}'/></linearGradient>"
+        "<rect width='48' height='48' fill='url(#g)'/>", "e", "stop-color", "black", "blue"},
+    {"pattern child",
+        "<pattern id='p' width='8' height='8' patternUnits='userSpaceOnUse'><rect id='e' width='{}' height='4' fill='purple'/></pattern>"
+        "<rect width='48' height='48' fill='url(#p)'/>", "e", "width", "4", "8"},
+    {"use target",
+        "<defs><rect id='e' width='{}' height='10' fill='green'/></defs>"
+        "<use href='#e' x='2' y='2'/><use href='#e' x='2' y='20'/>", "e", "width", "10", "30"},
+    {"use target descendant",
+        "<defs><g id='t'><rect id='e' width='10' height='10' fill='{}'/></g></defs>"
+        "<use href='#t' x='2' y='2'/><use href='#t' x='20' y='20' fill='red'/>", "e", "fill", "green", "blue"},
+    {"visible use target",
+        "<rect id='e' width='{}' height='10' fill='olive'/>"
+        "<use href='#e' y='20'/>", "e", "width", "10", "40"},
+    {"nested use target",
+        "<defs><circle id='e' cx='6' cy='6' r='{}' fill='maroon'/><g id='g'><use href='#e'/><use href='#e' x='14'/></g></defs>"
+        "<use href='#g'/><use href='#g' y='20'/>", "e", "r", "3", "6"},
+    {"use href",
+        "<defs><rect id='a' width='10' height='10' fill='green'/><circle id='b' cx='5' cy='5' r='5' fill='red'/></defs>"
+        "<use id='e' href='{}' x='4' y='4'/>", "e", "href", "#a", "#b"},
+    {"use target id",
+        "<defs><rect id='a' width='10' height='10' fill='green'/><circle id='{}' cx='5' cy='5' r='5' fill='red'/></defs>"
+        "<use href='#b' x='4' y='4'/>", "c", "id", "c", "b"},
+    {"use target renamed",
+        "<rect id='{}' width='10' height='10' fill='green'/><use href='#e' x='20' y='20'/>", "e", "id", "e", "f"},
+    {"symbol view box",
+        "<symbol id='e' viewBox='{}'><rect width='10' height='10' fill='teal'/></symbol>"
+        "<use href='#e' width='40' height='40'/>", "e", "viewBox", "0 0 10 10", "0 0 20 20"},
+};
+
+static std::string makeDocument(const char* content, const char* value)
+{
+    std::string body(content);
+    auto index = body.find("{}");
+    body.replace(index, 2, value);
+    return "<svg xmlns='http://www.w3.org/2000/svg' width='48' height='48'>" + body + "</svg>";
+}
+
+static bool sameBitmap(const Bitmap& a, const Bitmap& b)
+{
+    if(a.isNull() || a.width() != b.width() || a.height() != b.height())
+        return false;
+    for(int y = 0; y < a.height(); ++y) {
+        if(std::memcmp(a.data() + y * a.stride(), b.data() + y * b.stride(), a.width() * 4) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static std::unique_ptr<Document> loadDocument(const std::string& data)
+{
+    return Document::loadFromData(data);
+}
+
+static std::unique_ptr<Document> loadClone(const std::string& data)
+{
+    auto document = Document::loadFromData(data);
+    if(document == nullptr)
+        return nullptr;
+    return document->clone();
+}
+
+static std::unique_ptr<Document> loadSnapshot(const std::string& data)
+{
+    auto document = Document::loadFromData(data);
+    if(document == nullptr)
+        return nullptr;
+    auto snapshot = document->serialize();
+    return Document::loadFromSnapshot(snapshot.data(), snapshot.size());
+}
+
+static void testMutation(const MutationCase& mutation, std::unique_ptr<Document>(*load)(const std::string&))
+{
+    auto document = load(makeDocument(mutation.content, mutation.oldValue));
+    auto reference = Document::loadFromData(makeDocument(mutation.content, mutation.newValue));
+    if(document == nullptr || reference == nullptr) {
+        std::fprintf(stderr, "%s: failed to load\n", mutation.name);
+        CHECK(false);
+        return;
+    }
+
+    auto before = document->renderToBitmap();
+    CHECK(!sameBitmap(before, reference->renderToBitmap()));
+    auto element = document->getElementById(mutation.id);
+    element.setAttribute(mutation.attribute, mutation.newValue);
+    if(!sameBitmap(document->renderToBitmap(), reference->renderToBitmap())) {
+        std::fprintf(stderr, "%s: incremental layout differs from a fresh load\n", mutation.name);
+        CHECK(false);
+    }
+
+    element.setAttribute(mutation.attribute, mutation.oldValue);
+    if(!sameBitmap(document->renderToBitmap(), before)) {
+        std::fprintf(stderr, "%s: restoring the old value does not restore the rendering\n", mutation.name);
+        CHECK(false);
+    }
+}
+
+// The clones of a rebuilt instance registered references of their own. Renaming the
+// clip path afterwards must not touch the destroyed clones.
+static void testReferencesAfterRebuild()
+{
+    const char* content = "<clipPath id='c'><rect width='20' height='20'/></clipPath>"
+        "<g id='t'><rect id='r' width='{}' height='40' fill='blue' clip-path='url(#c)'/></g>"
+        "<use href='#t' x='8' y='8'/>";
+    auto document = Document::loadFromData(makeDocument(content, "40"));
+    auto reference = Document::loadFromData(makeDocument(content, "10"));
+    document->renderToBitmap();
+    document->getElementById("r").setAttribute("width", "10");
+    CHECK(sameBitmap(document->renderToBitmap(), reference->renderToBitmap()));
+    document->getElementById("c").setAttribute("id", "d");
+    reference->getElementById("c").setAttribute("id", "d");
+    CHECK(sameBitmap(document->renderToBitmap(), reference->renderToBitmap()));
+}
+
+int main()
+{
+    lunasvg_add_font_face_from_file("", false, false, "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf");
+    for(const auto& mutation : kCases) {
+        testMutation(mutation, loadDocument);
+        testMutation(mutation, loadClone);
+        testMutation(mutation, loadSnapshot);
+    }
+
+    testReferencesAfterRebuild();
+    return TEST_RESULT();
+}
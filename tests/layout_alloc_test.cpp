@@ -0,0 +1,71 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <new>
+#include <string>
+
+using namespace lunasvg;
+
+static size_t allocationCount = 0;
+
+void* operator new(size_t size)
+{
+    ++allocationCount;
+    if(auto data = std::malloc(size ? size : 1))
+        return data;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* data) noexcept
+{
+    std::free(data);
+}
+
+void operator delete(void* data, size_t) noexcept
+{
+    std::free(data);
+}
+
+static const char styleAttributes[] = "font-family='Helvetica, Arial, sans-serif' stroke='url(#g) blue' stroke-dasharray='1 2 3 4'"
+                                      " clip-path='url(#c)' mask='url(#m)' marker-start='url(#k)' marker-mid='url(#k)' marker-end='url(#k)'";
+
+static std::string makeDocument(int count, const char* groupAttributes, const char* pathAttributes)
+{
+    std::string content("<svg xmlns='http://www.w3.org/2000/svg' width='100' height='100'><defs>"
+                        "<linearGradient id='g'><stop offset='0' stop-color='red'/></linearGradient>"
+                        "<clipPath id='c'><rect width='50' height='50'/></clipPath>"
+                        "<mask id='m'><rect width='50' height='50' fill='white'/></mask>"
+                        "<marker id='k'><rect width='2' height='2'/></marker></defs><g ");
+    content += groupAttributes;
+    content += '>';
+    for(int index = 0; index < count; ++index) {
+        content += "<path d='M0 0L10 10' fill='red' ";
+        content += pathAttributes;
+        content += "/>";
+    }
+
+    return content + "</g></svg>";
+}
+
+static size_t countLayoutAllocations(const std::string& content)
+{
+    auto document = Document::loadFromData(content);
+    document->forceLayout();
+    const auto count = allocationCount;
+    document->forceLayout();
+    return allocationCount - count;
+}
+
+int main()
+{
+    const auto plain = countLayoutAllocations(makeDocument(100, "", ""));
+    CHECK(countLayoutAllocations(makeDocument(200, "", "")) == plain);
+
+    const auto inherited = countLayoutAllocations(makeDocument(100, styleAttributes, ""));
+    CHECK(countLayoutAllocations(makeDocument(200, styleAttributes, "")) == inherited);
+
+    const auto own = countLayoutAllocations(makeDocument(100, "", styleAttributes));
+    CHECK(countLayoutAllocations(makeDocument(200, "", styleAttributes)) - own <= 2 * 100);
+    return TEST_RESULT();
+}
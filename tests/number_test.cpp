@@ -0,0 +1,81 @@
+#include "svgparserutils.h"
+
+#include "test.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+
+using namespace lunasvg;
+
+static bool parseAll(std::string_view input, float& number)
+{
+    return parseNumber(input, number) && input.empty();
+}
+
+static void testExactValues()
+{
+    std::mt19937 random(7);
+    for(int index = 0; index < 100000; ++index) {
+        std::string text;
+        if(random() % 2)
+            text += '-';
+        text += std::to_string(random() % 100000);
+        if(random() % 3) {
+            text += '.';
+            text += std::to_string(random() % 1000000000);
+        }
+
+        const bool hasExponent = random() % 4 == 0;
+        if(hasExponent) {
+            text += 'e';
+            text += std::to_string(static_cast<int>(random() % 40) - 20);
+        }
+
+        float number = 0;
+        std::string_view input(text);
+        CHECK(parseNumber(input, number) && input.empty());
+        CHECK(number == static_cast<float>(std::strtod(text.data(), nullptr)));
+
+        // Doubles are exact on the fast path and within a few ulp past it.
+        double value = 0;
+        input = text;
+        const auto expected = std::strtod(text.data(), nullptr);
+        CHECK(parseNumber(input, value) && input.empty());
+        if(hasExponent) {
+            CHECK(std::fabs(value - expected) <= 4 * std::numeric_limits<double>::epsilon() * std::fabs(expected));
+        } else {
+            CHECK(value == expected);
+        }
+    }
+}
+
+static void testEdgeCases()
+{
+    float number = 0;
+    CHECK(parseAll("16777217", number) && number == 16777216.f);
+    CHECK(parseAll("0.1", number) && number == 0.1f);
+    CHECK(parseAll("-.5", number) && number == -0.5f);
+    CHECK(parseAll("+3e2", number) && number == 300.f);
+    CHECK(parseAll("1234567890123456789012345", number) && number == 1234567890123456789012345.f);
+    CHECK(parseAll("0.000000000000000000000000000000000000001", number) && number == 1e-39f);
+    CHECK(parseAll("1e-400", number) && number == 0.f);
+    CHECK(!parseAll("1e39", number));
+    CHECK(!parseAll("1.", number));
+    CHECK(!parseAll(".", number));
+    CHECK(!parseAll("e5", number));
+
+    std::string_view input("2em");
+    CHECK(parseNumber(input, number) && number == 2.f && input == "em");
+    input = "3ex";
+    CHECK(parseNumber(input, number) && number == 3.f && input == "ex");
+}
+
+int main()
+{
+    testExactValues();
+    testEdgeCases();
+    return TEST_RESULT();
+}
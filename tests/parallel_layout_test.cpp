@@ -0,0 +1,171 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lunasvg;
+
+// Lays out large groups with a thread pool and compares every result with serial layout.
+// The children share gradients, patterns, clips, masks, markers and <use> targets, so the
+// tasks resolve the same references and fill the same caches at the same time. Build with
+// -fsanitize=thread to check the shared state as well as the output; tsan.supp silences
+// the font cache lock that older runtimes cannot see.
+
+static void runOnThreads(size_t count, const std::function<void(size_t index)>& task)
+{
+    std::atomic<size_t> nextIndex(0);
+    auto worker = [&] {
+        for(auto index = nextIndex++; index < count; index = nextIndex++) {
+            task(index);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 3; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for(auto& thread : threads) {
+        thread.join();
+    }
+}
+
+static std::string makeChild(const char* prefix, int index)
+{
+    const auto id = prefix + std::to_string(index);
+    const auto x = std::to_string(index % 64 * 8);
+    const auto y = std::to_string(index / 64 * 8);
+    const auto translate = " transform='translate(" + x + " " + y + ")'";
+    switch(index % 10) {
+    case 0:
+        return "<rect id='" + id + "' x='" + x + "' y='" + y + "' width='7' height='7' fill='url(#lg)' clip-path='url(#user)'/>";
+    case 1:
+        return "<circle id='" + id + "' cx='" + x + "' cy='" + y + "' r='4' fill='url(#rg)' clip-path='url(#box)'/>";
+    case 2:
+        return "<path id='" + id + "'" + translate + " d='M1 1 L6 6 L1 6' fill='none' stroke='url(#linked)' marker-end='url(#dot)'/>";
+    case 3:
+        return "<rect id='" + id + "' x='" + x + "' y='" + y + "' width='8' height='8' fill='url(#tile)' mask='url(#fade)'/>";
+    case 4:
+        return "<use id='" + id + "' href='#icon' x='" + x + "' y='" + y + "' width='8' height='8' fill='url(#lg)'/>";
+    case 5:
+        return "<text id='" + id + "' x='" + x + "' y='" + std::to_string(index / 64 * 8 + 7) + "' font-size='7' fill='url(#linked)'>A</text>";
+    case 6:
+        return "<ellipse id='" + id + "'" + translate + " cx='4' cy='4' rx='4' ry='2' fill='none' stroke='url(#rg)' stroke-width='1.5' clip-path='url(#box)'/>";
+    case 7:
+        return "<g id='" + id + "'" + translate + " clip-path='url(#user)' opacity='0.8'><rect width='8' height='8' fill='url(#linked)'/></g>";
+    case 8:
+        return "<rect id='" + id + "' x='" + x + "' y='" + y + "' width='6' height='6' fill='url(#missing) teal' clip-path='url(#missing)'/>";
+    default:
+        return "<polyline id='" + id + "'" + translate + " points='0,0 4,8 8,0' fill='url(#lg)' stroke='url(#tile)' mask='url(#fade)'/>";
+    }
+}
+
+constexpr int kNestedChildCount = 1100;
+
+static int rowsHeight(int childCount)
+{
+    return (childCount + 63) / 64 * 8;
+}
+
+static std::string makeDocument(int childCount)
+{
+    const auto height = rowsHeight(childCount) + rowsHeight(kNestedChildCount);
+    std::string data = "<svg xmlns='http://www.w3.org/2000/svg' width='512' height='" + std::to_string(height) + "'>";
+    data += "<defs>"
+        "<linearGradient id='lg'><stop offset='0' stop-color='red'/><stop offset='1' stop-color='blue'/></linearGradient>"
+        "<linearGradient id='linked' href='#lg' gradientTransform='rotate(45)'/>"
+        "<radialGradient id='rg'><stop offset='0' stop-color='yellow'/><stop offset='1' stop-color='green'/></radialGradient>"
+        "<pattern id='tile' width='4' height='4' patternUnits='userSpaceOnUse'><rect width='2' height='2' fill='url(#lg)'/></pattern>"
+        "<clipPath id='user'><rect width='512' height='200'/><circle cx='256' cy='300' r='200'/></clipPath>"
+        "<clipPath id='box' clipPathUnits='objectBoundingBox' clip-path='url(#user)'><rect width='0.75' height='0.75'/></clipPath>"
+        "<mask id='fade'><rect width='512' height='512' fill='url(#rg)'/></mask>"
+        "<marker id='dot' markerWidth='4' markerHeight='4' refX='2' refY='2'><circle cx='2' cy='2' r='2' fill='url(#lg)'/></marker>"
+        "<symbol id='icon' viewBox='0 0 10 10'><path d='M5 0 L10 10 L0 10 Z' clip-path='url(#box)'/></symbol>"
+        "</defs>";
+    for(int i = 0; i < childCount; ++i)
+        data += makeChild("e", i);
+    // A large group inside a batch is laid out serially by the task that reaches it.
+    data += "<g id='nested' transform='translate(0 " + std::to_string(rowsHeight(childCount)) + ")'>";
+    for(int i = 0; i < kNestedChildCount; ++i)
+        data += makeChild("n", i);
+    data += "</g></svg>";
+    return data;
+}
+
+static bool sameBitmap(const Bitmap& a, const Bitmap& b)
+{
+    if(a.isNull() || a.width() != b.width() || a.height() != b.height())
+        return false;
+    for(int y = 0; y < a.height(); ++y) {
+        if(std::memcmp(a.data() + y * a.stride(), b.data() + y * b.stride(), a.width() * 4) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool sameBox(const Box& a, const Box& b)
+{
+    return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+static void compareDocuments(Document& serial, Document& parallel, int childCount)
+{
+    CHECK(sameBitmap(serial.renderToBitmap(), parallel.renderToBitmap()));
+    for(int i = 0; i < childCount; i += 7) {
+        auto id = "e" + std::to_string(i);
+        CHECK(sameBox(serial.getElementById(id).getBoundingBox(), parallel.getElementById(id).getBoundingBox()));
+    }
+
+    CHECK(sameBox(serial.boundingBox(), parallel.boundingBox()));
+}
+
+static void testParallelLayout(bool deferAttributeParsing)
+{
+    const int childCount = 2500;
+    const auto data = makeDocument(childCount);
+    ParseOptions options;
+    options.deferAttributeParsing = deferAttributeParsing;
+    auto serial = Document::loadFromData(data.data(), data.size(), options);
+    auto parallel = Document::loadFromData(data.data(), data.size(), options);
+    if(serial == nullptr || parallel == nullptr) {
+        CHECK(false);
+        return;
+    }
+
+    std::atomic<size_t> taskCount(0);
+    parallel->setLayoutExecutor([&taskCount](size_t count, const std::function<void(size_t index)>& task) {
+        taskCount += count;
+        runOnThreads(count, task);
+    });
+
+    compareDocuments(*serial, *parallel, childCount);
+    CHECK(taskCount > 0);
+
+    // Shared targets lay out the whole document again.
+    for(auto document : {serial.get(), parallel.get()}) {
+        document->getElementById("lg").children().front().toElement().setAttribute("stop-color", "purple");
+        document->getElementById("box").setAttribute("clipPathUnits", "userSpaceOnUse");
+        document->getElementById("e4").setAttribute("href", "#e1");
+    }
+
+    compareDocuments(*serial, *parallel, childCount);
+    for(int i = 0; i < 3; ++i) {
+        parallel->forceLayout();
+        compareDocuments(*serial, *parallel, childCount);
+    }
+}
+
+int main()
+{
+    lunasvg_add_font_face_from_file("", false, false, "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf");
+    testParallelLayout(false);
+    testParallelLayout(true);
+    return TEST_RESULT();
+}
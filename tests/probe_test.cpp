@@ -0,0 +1,134 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <string>
+
+using namespace lunasvg;
+
+static void appendLittleEndian(std::string& output, uint32_t value, int count)
+{
+    for(int index = 0; index < count; ++index) {
+        output += static_cast<char>(value >> (8 * index));
+    }
+}
+
+static std::string makeStoredGzip(const std::string& content, size_t blockSize)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for(auto value : content) {
+        crc ^= static_cast<uint8_t>(value);
+        for(int bit = 0; bit < 8; ++bit) {
+            crc = crc & 1 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+        }
+    }
+
+    std::string output("\x1F\x8B\x08\0\0\0\0\0\0\x03", 10);
+    for(size_t offset = 0; offset < content.size(); offset += blockSize) {
+        const auto length = std::min(blockSize, content.size() - offset);
+        output += static_cast<char>(offset + length == content.size());
+        appendLittleEndian(output, length, 2);
+        appendLittleEndian(output, ~length & 0xFFFF, 2);
+        output.append(content, offset, length);
+    }
+
+    appendLittleEndian(output, crc ^ 0xFFFFFFFF, 4);
+    appendLittleEndian(output, content.size(), 4);
+    return output;
+}
+
+static std::string makeDocument(const std::string& rootAttributes, const std::string& prolog = std::string())
+{
+    return prolog + "<svg xmlns='http://www.w3.org/2000/svg' " + rootAttributes + ">"
+        "<rect x='10' y='5' width='30' height='20'/></svg>";
+}
+
+static bool sameBox(const Box& a, const Box& b)
+{
+    return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+// The probed size must match what a full load reports.
+static void checkProbe(const std::string& data, float expectedWidth, float expectedHeight, const Box& expectedViewBox)
+{
+    float width = -1, height = -1;
+    Box viewBox(-1, -1, -1, -1);
+    CHECK(Document::probe(data.data(), data.size(), width, height, viewBox));
+    CHECK(width == expectedWidth && height == expectedHeight);
+    CHECK(sameBox(viewBox, expectedViewBox));
+
+    auto document = Document::loadFromData(data.data(), data.size());
+    CHECK(document && document->width() == width && document->height() == height);
+}
+
+static void testSize()
+{
+    checkProbe(makeDocument("width='120' height='80'"), 120, 80, Box());
+    checkProbe(makeDocument("width='1in' height='2.54cm'"), 96, 96, Box());
+    checkProbe(makeDocument("width='120' height='80' viewBox='0 0 12 8'"), 120, 80, Box(0, 0, 12, 8));
+}
+
+static void testViewBoxOnly()
+{
+    checkProbe(makeDocument("viewBox='-5 -5 40 30'"), 40, 30, Box(-5, -5, 40, 30));
+    checkProbe(makeDocument("width='80' viewBox='0 0 40 30'"), 80, 60, Box(0, 0, 40, 30));
+    checkProbe(makeDocument("height='15' viewBox='0 0 40 30'"), 20, 15, Box(0, 0, 40, 30));
+    checkProbe(makeDocument("width='100%' height='50%' viewBox='0 0 40 30'"), 40, 30, Box(0, 0, 40, 30));
+}
+
+static void testFallback()
+{
+    // Relative sizes need the full document: em and ex use the computed font size,
+    // and a missing size without a view box uses the content bounds.
+    checkProbe(makeDocument("width='10em' height='4ex' font-size='20'"), 200, 40, Box());
+    checkProbe(makeDocument("width='10em' height='10' style='font-size: 3px'"), 30, 10, Box());
+    checkProbe(makeDocument(""), 40, 25, Box());
+    checkProbe(makeDocument("width='100%' height='100%'"), 40, 25, Box());
+}
+
+static void testGzip()
+{
+    const auto content = makeDocument("width='120' height='80' viewBox='0 0 12 8'", "<!--" + std::string(100000, '-' + 1) + "-->");
+    float width = 0, height = 0;
+    Box viewBox;
+    for(size_t blockSize : {7, 4096, 65535}) {
+        const auto data = makeStoredGzip(content, blockSize);
+        CHECK(Document::probe(data.data(), data.size(), width, height, viewBox));
+        CHECK(width == 120 && height == 80 && sameBox(viewBox, Box(0, 0, 12, 8)));
+
+        // Only the data up to the root start tag is inflated.
+        const auto truncated = data.substr(0, data.size() - 28);
+        CHECK(Document::probe(truncated.data(), truncated.size(), width, height, viewBox));
+        CHECK(width == 120 && height == 80);
+    }
+
+    const auto fallback = makeStoredGzip(makeDocument("width='10em' height='10' font-size='2'"), 16);
+    CHECK(Document::probe(fallback.data(), fallback.size(), width, height, viewBox));
+    CHECK(width == 20 && height == 10);
+
+    const auto empty = makeStoredGzip("<!-- no root element -->", 16);
+    CHECK(!Document::probe(empty.data(), empty.size(), width, height, viewBox));
+}
+
+static void testInvalid()
+{
+    float width = 0, height = 0;
+    Box viewBox;
+    const std::string notSvg("<html width='10' height='10'></html>");
+    CHECK(!Document::probe(notSvg.data(), notSvg.size(), width, height, viewBox));
+    const std::string unterminated("<svg xmlns='http://www.w3.org/2000/svg' width='10' height='10'");
+    CHECK(!Document::probe(unterminated.data(), unterminated.size(), width, height, viewBox));
+    const std::string startTagOnly("<svg xmlns='http://www.w3.org/2000/svg' width='10' height='12'>");
+    CHECK(Document::probe(startTagOnly.data(), startTagOnly.size(), width, height, viewBox));
+    CHECK(width == 10 && height == 12);
+}
+
+int main()
+{
+    testSize();
+    testViewBoxOnly();
+    testFallback();
+    testGzip();
+    testInvalid();
+    return TEST_RESULT();
+}
@@ -0,0 +1,135 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+using namespace lunasvg;
+
+static const char* documents[] = {
+    R"SVG(<svg xmlns="http://www.w3.org/2000/svg" width="64" height="48" viewBox="0 0 64 48">
+         <rect id="r" x="4" y="4" width="20" height="12" rx="3" fill="#336699" stroke="red" stroke-width="2"/>
+         <circle id="c" cx="40" cy="24" r="10" fill-opacity="0.5"/>
+         <ellipse cx="12" cy="36" rx="8" ry="4" fill="green"/>
+         <line x1="0" y1="0" x2="64" y2="48" stroke="black"/>
+         <polyline points="0,48 16,32 32,48" fill="none" stroke="blue"/>
+       </svg>)SVG",
+    R"SVG(<svg xmlns="http://www.w3.org/2000/svg" width="50" height="50">
+         <path id="p" d="M5 5 h20 v20 q-10 10 -20 0 z M30 30 a10 10 0 1 0 10 10 c2 2 4 4 6 0 s2 -4 4 0 t4 4" fill="orange" fill-rule="evenodd"/>
+       </svg>)SVG",
+    R"SVG(<svg xmlns="http://www.w3.org/2000/svg" xmlns:xlink="http://www.w3.org/1999/xlink" width="60" height="60">
+         <defs>
+           <linearGradient id="g" x1="0" x2="1"><stop offset="0" stop-color="red"/><stop offset="1" stop-color="blue"/></linearGradient>
+           <symbol id="s" viewBox="0 0 10 10"><rect width="10" height="10" fill="url(#g)"/></symbol>
+           <clipPath id="clip"><circle cx="30" cy="30" r="25"/></clipPath>
+         </defs>
+         <g clip-path="url(#clip)">
+           <use id="u" xlink:href="#s" x="5" y="5" width="30" height="30"/>
+           <use href="#s" x="25" y="25" width="30" height="30" transform="rotate(10)"/>
+         </g>
+       </svg>)SVG",
+    R"SVG(<svg xmlns="http://www.w3.org/2000/svg" width="80" height="40">
+         <style>.a { fill: purple } #t { font-size: 12px } rect + rect { stroke: black }</style>
+         <rect class="a" width="10" height="10"/>
+         <rect class="a" x="12" width="10" height="10"/>
+         <text id="t" x="30" y="20">Hello <tspan fill="red">snapshot</tspan></text>
+       </svg>)SVG",
+};
+
+static bool sameBox(const Box& a, const Box& b)
+{
+    return std::fabs(a.x - b.x) < 1e-3f && std::fabs(a.y - b.y) < 1e-3f
+        && std::fabs(a.w - b.w) < 1e-3f && std::fabs(a.h - b.h) < 1e-3f;
+}
+
+static bool sameBitmap(const Bitmap& a, const Bitmap& b)
+{
+    if(a.width() != b.width() || a.height() != b.height())
+        return false;
+    for(int y = 0; y < a.height(); ++y) {
+        if(std::memcmp(a.data() + y * a.stride(), b.data() + y * b.stride(), a.width() * 4) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void testRoundTrip(const char* content)
+{
+    auto document = Document::loadFromData(content);
+    CHECK(document != nullptr);
+    if(document == nullptr)
+        return;
+    auto snapshot = document->serialize();
+    CHECK(snapshot == document->serialize());
+
+    auto loaded = Document::loadFromSnapshot(snapshot.data(), snapshot.size());
+    CHECK(loaded != nullptr);
+    if(loaded == nullptr)
+        return;
+    CHECK(loaded->serialize() == snapshot);
+    CHECK(loaded->width() == document->width());
+    CHECK(loaded->height() == document->height());
+    CHECK(sameBox(loaded->boundingBox(), document->boundingBox()));
+    CHECK(sameBitmap(loaded->renderToBitmap(), document->renderToBitmap()));
+
+    for(const char* id : { "r", "c", "p", "g", "s", "u", "t" }) {
+        auto element = document->getElementById(id);
+        auto loadedElement = loaded->getElementById(id);
+        CHECK(element.isNull() == loadedElement.isNull());
+        if(element.isNull() || loadedElement.isNull())
+            continue;
+        CHECK(loadedElement.getAttribute("id") == id);
+        CHECK(sameBox(loadedElement.getBoundingBox(), element.getBoundingBox()));
+        CHECK(sameBox(loadedElement.getGlobalBoundingBox(), element.getGlobalBoundingBox()));
+    }
+}
+
+static void testSerializeBeforeLayout()
+{
+    auto document = Document::loadFromData(documents[1]);
+    auto before = document->serialize();
+    document->forceLayout();
+    CHECK(document->serialize() == before);
+}
+
+static void testMalformed(const std::vector<uint8_t>& snapshot)
+{
+    for(size_t length = 0; length < snapshot.size(); ++length) {
+        CHECK(Document::loadFromSnapshot(snapshot.data(), length) == nullptr);
+    }
+
+    auto badMagic = snapshot;
+    badMagic[0] ^= 0xFF;
+    CHECK(Document::loadFromSnapshot(badMagic.data(), badMagic.size()) == nullptr);
+
+    auto badVersion = snapshot;
+    badVersion[4] ^= 0xFF;
+    CHECK(Document::loadFromSnapshot(badVersion.data(), badVersion.size()) == nullptr);
+
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<size_t> position(0, snapshot.size() - 1);
+    std::uniform_int_distribution<int> value(0, 255);
+    for(int iteration = 0; iteration < 2000; ++iteration) {
+        auto corrupted = snapshot;
+        for(int count = 0; count < 4; ++count)
+            corrupted[position(random)] = static_cast<uint8_t>(value(random));
+        if(auto document = Document::loadFromSnapshot(corrupted.data(), corrupted.size())) {
+            document->renderToBitmap(16, 16);
+        }
+    }
+}
+
+int main()
+{
+    for(const char* content : documents) {
+        testRoundTrip(content);
+        testMalformed(Document::loadFromData(content)->serialize());
+    }
+
+    testSerializeBeforeLayout();
+    return TEST_RESULT();
+}
@@ -0,0 +1,216 @@
+#include <lunasvg.h>
+
+#include "test.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace lunasvg;
+
+// Siblings with equal style attributes share one computed style, and each parent keeps a
+// small cache of recent sibling styles. Every case lays out siblings that differ only in one
+// style property and compares them against the same elements each wrapped in its own group,
+// where nothing can be shared.
+struct StyleCase {
+    const char* name;
+    const char* defs;
+    const char* parent;
+    const char* element;
+    const char* property;
+    std::vector<const char*> values;
+};
+
+static const StyleCase kCases[] = {
+    {"fill", "", "", "<rect width='30' height='30'{}/>", "fill", {"red", "green", "blue", "orange", "purple"}},
+    {"inherited fill", "", "fill='gray'", "<rect width='30' height='30'{}/>", "fill", {"inherit", "red", "currentColor", "none", "teal"}},
+    {"color", "", "", "<rect width='30' height='30' fill='currentColor'{}/>", "color", {"red", "green", "blue", "orange", "purple"}},
+    {"fill opacity", "", "fill='navy'", "<rect width='30' height='30'{}/>", "fill-opacity", {"0.1", "0.3", "0.5", "0.7", "90%"}},
+    {"opacity", "", "fill='navy'", "<rect width='30' height='30'{}/>", "opacity", {"0.1", "0.3", "0.5", "0.7", "0.9"}},
+    {"stroke", "", "stroke-width='4'", "<rect x='4' y='4' width='24' height='24' fill='none'{}/>", "stroke", {"red", "green", "blue", "orange", "purple"}},
+    {"stroke width", "", "stroke='black' fill='none'", "<rect x='6' y='6' width='20' height='20'{}/>", "stroke-width", {"1", "2", "3", "5", "0.5em"}},
+    {"stroke opacity", "", "stroke='black' stroke-width='6' fill='none'", "<rect x='6' y='6' width='20' height='20'{}/>", "stroke-opacity", {"0.1", "0.3", "0.5", "0.7", "0.9"}},
+    {"stroke dasharray", "", "stroke='black' stroke-width='2' fill='none'", "<rect x='4' y='4' width='24' height='24'{}/>", "stroke-dasharray", {"1", "2 2", "4 1", "6 3", "none"}},
+    {"stroke dashoffset", "", "stroke='black' stroke-width='2' stroke-dasharray='5 3' fill='none'", "<rect x='4' y='4' width='24' height='24'{}/>", "stroke-dashoffset", {"0", "1", "2", "3", "4"}},
+    {"stroke linecap", "", "stroke='black' stroke-width='8'", "<path d='M8 16 L24 16'{}/>", "stroke-linecap", {"butt", "round", "square", "butt", "round"}},
+    {"stroke linejoin", "", "stroke='black' stroke-width='6' fill='none'", "<path d='M6 26 L16 6 L26 26'{}/>", "stroke-linejoin", {"miter", "round", "bevel", "miter", "round"}},
+    {"stroke miterlimit", "", "stroke='black' stroke-width='4' fill='none'", "<path d='M4 26 L16 4 L28 26'{}/>", "stroke-miterlimit", {"1", "2", "4", "8", "1.5"}},
+    {"fill rule", "", "fill='black'", "<path d='M2 2 H30 V30 H2 Z M8 8 H24 V24 H8 Z'{}/>", "fill-rule", {"nonzero", "evenodd", "nonzero", "evenodd", "nonzero"}},
+    {"visibility", "", "fill='black'", "<rect width='30' height='30'{}/>", "visibility", {"visible", "hidden", "collapse", "visible", "hidden"}},
+    {"display", "", "fill='black'", "<rect width='30' height='30'{}/>", "display", {"inline", "none", "block", "none", "inline"}},
+    {"clip path",
+        "<clipPath id='c1'><rect width='10' height='30'/></clipPath><clipPath id='c2'><rect width='30' height='10'/></clipPath>"
+        "<clipPath id='c3'><circle cx='15' cy='15' r='8'/></clipPath>",
+        "fill='black'", "<rect width='30' height='30'{}/>", "clip-path", {"url(#c1)", "url(#c2)", "url(#c3)", "none", "url(#c1)"}},
+    {"mask",
+        "<mask id='m1'><rect width='30' height='30' fill='#404040'/></mask><mask id='m2'><rect width='15' height='30' fill='white'/></mask>"
+        "<mask id='m3' mask-type='alpha'><rect width='30' height='15' fill='black'/></mask>",
+        "fill='black'", "<rect width='30' height='30'{}/>", "mask", {"url(#m1)", "url(#m2)", "url(#m3)", "none", "url(#m2)"}},
+    {"marker end",
+        "<marker id='k1' markerWidth='6' markerHeight='6' refX='3' refY='3'><rect width='6' height='6' fill='red'/></marker>"
+        "<marker id='k2' markerWidth='6' markerHeight='6' refX='3' refY='3'><circle cx='3' cy='3' r='3' fill='blue'/></marker>",
+        "stroke='black'", "<path d='M4 4 L26 26'{}/>", "marker-end", {"url(#k1)", "url(#k2)", "none", "url(#k1)", "url(#k2)"}},
+    {"overflow", "", "",
+        "<svg width='30' height='30' viewBox='0 0 10 10'{}><rect x='-5' y='-5' width='20' height='20' fill='green'/></svg>",
+        "overflow", {"hidden", "visible", "auto", "visible", "hidden"}},
+    {"font size", "", "fill='black'", "<text y='24'{}>Ag</text>", "font-size", {"8", "12", "16", "20", "150%"}},
+    {"font weight", "", "fill='black' font-size='16'", "<text y='24'{}>Ag</text>", "font-weight", {"normal", "bold", "normal", "bold", "normal"}},
+    {"letter spacing", "", "fill='black' font-size='12'", "<text y='24'{}>Ag</text>", "letter-spacing", {"0", "2", "4", "normal", "6"}},
+    {"text anchor", "", "fill='black' font-size='12'", "<text x='15' y='24'{}>Ag</text>", "text-anchor", {"start", "middle", "end", "start", "middle"}},
+    {"word spacing", "", "fill='black' font-size='12'", "<text y='24'{}>A g</text>", "word-spacing", {"0", "2", "4", "normal", "6"}},
+    {"dominant baseline", "", "fill='black' font-size='12'", "<text y='16'{}>Ag</text>", "dominant-baseline", {"auto", "middle", "hanging", "central", "text-top"}},
+};
+
+enum class Delivery {
+    Attribute,
+    StyleAttribute,
+    ClassRule
+};
+
+// The first values are repeated after the cache has cycled, and plain siblings are mixed in.
+static std::vector<int> siblingOrder(size_t valueCount)
+{
+    std::vector<int> order;
+    for(size_t i = 0; i < valueCount; ++i)
+        order.push_back(static_cast<int>(i));
+    order.push_back(-1);
+    order.push_back(0);
+    order.push_back(1);
+    order.push_back(-1);
+    order.push_back(0);
+    return order;
+}
+
+static std::string makeSibling(const StyleCase& style, int index, int valueIndex, Delivery delivery)
+{
+    std::string declaration = " transform='translate(" + std::to_string(index % 4 * 32) + " " + std::to_string(index / 4 * 32) + ")'";
+    if(valueIndex >= 0) {
+        const char* value = style.values[valueIndex];
+        switch(delivery) {
+        case Delivery::Attribute:
+            declaration += std::string(" ") + style.property + "='" + value + "'";
+            break;
+        case Delivery::StyleAttribute:
+            declaration += std::string(" style='") + style.property + ":" + value + "'";
+            break;
+        case Delivery::ClassRule:
+            declaration += " class='v" + std::to_string(valueIndex) + "'";
+            break;
+        }
+    }
+
+    std::string element(style.element);
+    auto position = element.find("{}");
+    element.replace(position, 2, declaration);
+    return element;
+}
+
+static std::string makeDocument(const StyleCase& style, Delivery delivery, bool isolated)
+{
+    std::string data = "<svg xmlns='http://www.w3.org/2000/svg' width='128' height='96'>";
+    if(delivery == Delivery::ClassRule) {
+        data += "<style>";
+        for(size_t i = 0; i < style.values.size(); ++i)
+            data += ".v" + std::to_string(i) + "{" + style.property + ":" + style.values[i] + "}";
+        data += "</style>";
+    }
+
+    data += std::string("<defs>") + style.defs + "</defs>";
+    data += std::string("<g ") + style.parent + ">";
+    auto order = siblingOrder(style.values.size());
+    for(size_t i = 0; i < order.size(); ++i) {
+        auto sibling = makeSibling(style, static_cast<int>(i), order[i], delivery);
+        if(isolated) {
+            data += "<g>" + sibling + "</g>";
+        } else {
+            data += sibling;
+        }
+    }
+
+    data += "</g></svg>";
+    return data;
+}
+
+static bool sameBitmap(const Bitmap& a, const Bitmap& b)
+{
+    if(a.isNull() || a.width() != b.width() || a.height() != b.height())
+        return false;
+    for(int y = 0; y < a.height(); ++y) {
+        if(std::memcmp(a.data() + y * a.stride(), b.data() + y * b.stride(), a.width() * 4) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void testStyle(const StyleCase& style, Delivery delivery)
+{
+    static const char* deliveryNames[] = {"attribute", "style attribute", "class rule"};
+    auto document = Document::loadFromData(makeDocument(style, delivery, false));
+    auto reference = Document::loadFromData(makeDocument(style, delivery, true));
+    if(document == nullptr || reference == nullptr) {
+        std::fprintf(stderr, "%s (%s): failed to load\n", style.name, deliveryNames[static_cast<int>(delivery)]);
+        CHECK(false);
+        return;
+    }
+
+    if(!sameBitmap(document->renderToBitmap(), reference->renderToBitmap())) {
+        std::fprintf(stderr, "%s (%s): siblings share a style they should not\n", style.name, deliveryNames[static_cast<int>(delivery)]);
+        CHECK(false);
+    }
+}
+
+// The cached entries are keyed by element, so a sibling changed after layout must not keep
+// the style it had before.
+static void testMutatedSiblings()
+{
+    const char* content = "<svg xmlns='http://www.w3.org/2000/svg' width='96' height='32'><g fill='gray'>"
+        "<rect id='a' width='30' height='30' fill='red'/>"
+        "<rect id='b' x='32' width='30' height='30' fill='red'/>"
+        "<rect id='c' x='64' width='30' height='30' style='fill:red'/>"
+        "</g></svg>";
+    auto document = Document::loadFromData(content);
+    document->renderToBitmap();
+    document->getElementById("b").setAttribute("fill", "blue");
+    document->getElementById("c").setAttribute("fill", "green");
+
+    auto reference = Document::loadFromData(
+        "<svg xmlns='http://www.w3.org/2000/svg' width='96' height='32'><g fill='gray'>"
+        "<rect width='30' height='30' fill='red'/>"
+        "<rect x='32' width='30' height='30' fill='blue'/>"
+        "<rect x='64' width='30' height='30' fill='green'/>"
+        "</g></svg>");
+    CHECK(sameBitmap(document->renderToBitmap(), reference->renderToBitmap()));
+}
+
+// Instances of one target carry equal attributes but inherit from different <use> elements.
+static void testInheritedThroughUse()
+{
+    auto document = Document::loadFromData(
+        "<svg xmlns='http://www.w3.org/2000/svg' width='96' height='32'>"
+        "<defs><rect id='r' width='30' height='30'/></defs>"
+        "<use href='#r' fill='red'/><use href='#r' x='32' fill='green'/><use href='#r' x='64' fill='blue'/>"
+        "</svg>");
+    auto reference = Document::loadFromData(
+        "<svg xmlns='http://www.w3.org/2000/svg' width='96' height='32'>"
+        "<rect width='30' height='30' fill='red'/><rect x='32' width='30' height='30' fill='green'/>"
+        "<rect x='64' width='30' height='30' fill='blue'/>"
+        "</svg>");
+    CHECK(sameBitmap(document->renderToBitmap(), reference->renderToBitmap()));
+}
+
+int main()
+{
+    lunasvg_add_font_face_from_file("", false, false, "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf");
+    lunasvg_add_font_face_from_file("", true, false, "/usr/share/fonts/truetype/dejavu/DejaVuSans-Bold.ttf");
+    for(const auto& style : kCases) {
+        testStyle(style, Delivery::Attribute);
+        testStyle(style, Delivery::StyleAttribute);
+        testStyle(style, Delivery::ClassRule);
+    }
+
+    testMutatedSiblings();
+    testInheritedThroughUse();
+    return TEST_RESULT();
+}
@@ -0,0 +1,19 @@
+#ifndef LUNASVG_TEST_H
+#define LUNASVG_TEST_H
+
+#include <cstdio>
+#include <cstdlib>
+
+static int testFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if(!(condition)) { \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++testFailures; \
+        } \
+    } while(0)
+
+#define TEST_RESULT() (testFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
+
+#endif // LUNASVG_TEST_H